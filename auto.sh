@@ -10,7 +10,7 @@ do
                 for r in 1 2 3 4 5
                 do
                     echo PROBLEM data-$H-$W-$n.dat with $(($H + 2))
-                    bin/dyn -f ../data/data$H-$W-$n.dat -t 10 -d $c -n $(($H
+                    bin/dyn -f data.tar:data/data$H-$W-$n.dat -t 10 -d $c -n $(($H
                     + 2)) -c 1
                     cat result.dat >> result17-Medium-v2.dat
                 done
@@ -0,0 +1,176 @@
+/***************************************************************************
+ *   Copyright (C) 2008 by Marco Caserta                                   *
+ *   marco dot caserta at uni-hamburg dot de                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*! \file bay.h
+  \brief Flat, fixed-capacity representation of a bay
+
+  A bay with \c m stacks, each of which can hold at most \c cap blocks, is
+  stored as a single contiguous array of \c m x \c cap tiers (stack \c i
+  occupies positions \c i*cap to \c (i+1)*cap-1, from bottom to top) plus an
+  array with the current height of each stack. Copying a bay onto another
+  bay of the same size is therefore a plain copy of a few contiguous blocks
+  of memory, without any heap allocation.
+
+  In addition, the position of every block (the index of its slot in the
+  tier array, or -1 once the block has been retrieved) is maintained by
+  push() and pop(), so that a block can be located in constant time.
+  Likewise, each tier stores the minimum block found from the bottom of its
+  stack up to that tier, so that the minimum of a stack is always available
+  in constant time (the minimum of the top tier). The number of blocking
+  blocks (blocks placed above a smaller block, each of which must be
+  relocated at least once) is maintained as well, together with a Zobrist
+  hash of the configuration (the xor of a key for each block and slot), so
+  that identical bays reached along different paths can be recognized (see
+  ttable.h).
+*/
+#ifndef bay_H
+#define bay_H
+#include <vector>
+#include <climits>
+#include <cassert>
+#include <stdint.h>
+#include "rng.h"
+
+/// A single step of a solution path
+/** The block on top of stack \c from is relocated onto stack \c to or, if
+  \c to is -1, retrieved from the bay. A solution is stored as the sequence
+  of its moves; the bays it goes through are rebuilt on demand by applying
+  the moves to the initial configuration (see bay_t::apply()).
+  */
+struct move_t {
+  int from;                     //!< Stack the block is taken from
+  int to;                       //!< Stack the block is put on (-1 : retrieval)
+};
+
+/// A step of a solution path identified by the block moved
+/** Block \c el is relocated onto stack \c to or, if \c to is -1,
+  retrieved. Unlike a move_t, a step given by block still makes sense once
+  the bay has changed (see solution_plan() and repair_solution()).
+  */
+struct block_move_t {
+  int el;                       //!< Block moved
+  int to;                       //!< Stack the block is put on (-1 : retrieval)
+};
+
+/// Zobrist key of block \c el placed in slot \c slot
+inline uint64_t zobrist(int slot, int el)
+{
+  uint64_t x = ((uint64_t)(uint32_t)slot << 32) | (uint32_t)el;
+  return splitmix64(x);
+}
+
+class bay_t {
+public:
+  int m;                        //!< Number of stacks
+  int cap;                      //!< Max number of blocks in each stack
+  std::vector<int> tiers;       //!< Blocks of the bay, stack by stack (m x cap)
+  std::vector<int> height;      //!< Current number of blocks in each stack
+  std::vector<int> mins;        //!< Min block from the bottom up to each tier (m x cap)
+  std::vector<int> pos;         //!< Slot of each block in tiers (-1 if not in the bay)
+  int n_bad;                    //!< Number of blocks placed above a smaller block
+  uint64_t hash;                //!< Zobrist hash of the configuration
+
+  bay_t(void) : m(0), cap(0), n_bad(0), hash(0) {}
+  /// Empty bay with \c m_ stacks of capacity \c cap_, for blocks 1 to \c max_el
+  bay_t(int m_, int cap_, int max_el) : m(m_), cap(cap_), tiers(m_*cap_, 0),
+    height(m_, 0), mins(m_*cap_, INT_MAX), pos(max_el + 1, -1), n_bad(0), hash(0) {}
+
+  /// Number of blocks currently in stack \c i
+  int size(int i) const { return height[i]; }
+  /// Block in stack \c i, tier \c j (tier 0 is the bottom of the stack)
+  int at(int i, int j) const { return tiers[i*cap + j]; }
+  /// Block on top of stack \c i (the stack must not be empty)
+  int top(int i) const { return tiers[i*cap + height[i] - 1]; }
+  /// Min block in stack \c i (INT_MAX if the stack is empty)
+  int min_el(int i) const
+  {
+    return (height[i] == 0) ? INT_MAX : mins[i*cap + height[i] - 1];
+  }
+
+  /// Find stack \c row and tier \c col of block \c el in constant time
+  bool locate(int el, int & row, int & col) const
+  {
+    int slot = pos[el];
+    if (slot < 0)
+    {
+      row = -1;
+      col = -1;
+      return false;
+    }
+    row = slot / cap;
+    col = slot - row*cap;
+    return true;
+  }
+
+  /// Put block \c el on top of stack \c i
+  void push(int i, int el)
+  {
+    assert(height[i] < cap);
+    int slot    = i*cap + height[i];
+    tiers[slot] = el;
+    bool bad    = (height[i] > 0 && mins[slot-1] < el);
+    mins[slot]  = bad ? mins[slot-1] : el;
+    n_bad      += bad;
+    hash       ^= zobrist(slot, el);
+    pos[el]     = slot;
+    height[i]++;
+  }
+  /// Remove the block on top of stack \c i and return it
+  int pop(int i)
+  {
+    assert(height[i] > 0);
+    height[i]--;
+    int slot = i*cap + height[i];
+    int el   = tiers[slot];
+    pos[el]  = -1;
+    hash    ^= zobrist(slot, el);
+    if (mins[slot] != el)
+      n_bad--;
+    return el;
+  }
+  /// Relocate the block on top of stack \c from onto stack \c to
+  void move(int from, int to) { push(to, pop(from)); }
+  /// Apply a move of a solution path
+  void apply(const move_t & mv)
+  {
+    if (mv.to < 0)
+      pop(mv.from);
+    else
+      move(mv.from, mv.to);
+  }
+  /// Undo the \c moves previously applied to the bay, last move first
+  /** Blocks are retrieved in increasing order, the first retrieval of
+    \c moves being block \c first_el, so the block to be put back for each
+    retrieval is known. The cost is linear in the number of moves.
+    */
+  void rollback(const std::vector<move_t> & moves, int first_el)
+  {
+    int el = first_el;
+    for (unsigned k = 0; k < moves.size(); k++)
+      if (moves[k].to < 0)
+        el++;
+    for (int k = (int)moves.size() - 1; k >= 0; k--)
+      if (moves[k].to < 0)
+        push(moves[k].from, --el);
+      else
+        move(moves[k].to, moves[k].from);
+  }
+};
+#endif
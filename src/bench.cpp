@@ -0,0 +1,269 @@
+/***************************************************************************
+ *   Copyright (C) 2008 by Marco Caserta                                   *
+ *   marco dot caserta at uni-hamburg dot de                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+/*! \file bench.cpp
+  \brief Micro-benchmarks of the hot kernels of the solver
+
+  The kernels of the corridor method are timed on their own, on the first
+  instance of each class of data.tar (or on the instances given on the
+  command line, files or archive members, possibly as glob patterns):
+  - find_element : location of a block in the bay (one look-up per op)
+  - block_heuristic : look-ahead rollout from the initial bay
+  - define_stochastic_corridor : corridor of the first relocation
+  - neighborhood_search : evaluation of the neighborhood of the first
+    relocation (one rollout per candidate, transposition table disabled)
+
+  The corridor and neighborhood kernels are run on the bay reached after
+  the retrievals that need no relocation, with the random stream of the
+  given seed, so that every version of the code times the same work.
+  Each kernel is repeated until the time budget (-t) is spent. For each
+  kernel we report ns/op, the number of heap allocations per op, counted
+  by replacing the global operator new, and rollouts per second. With -o,
+  the same figures are written in CSV format, one row per instance and
+  kernel, for tracking regressions across versions. With -v, the rollouts
+  (block_heuristic and neighborhood_search) stop after the given number of
+  blocks (see cm_run::horizon_at()).
+
+  Usage: bench [-t seconds] [-n max_height] [-d width] [-s seed] [-v horizon] [-o file.csv] [instance ...]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <new>
+#include <string>
+#include <vector>
+#include "timer.h"
+#include "bay.h"
+#include "heuristic.h"
+#include "instance.h"
+#include "containers.h"
+
+using namespace std;
+
+static long n_alloc = 0;	//!< Number of calls to operator new
+
+void * operator new(size_t size)
+{
+   n_alloc++;
+   void * p = malloc(size == 0 ? 1 : size);
+   if (p == 0)
+      throw std::bad_alloc();
+   return p;
+}
+void * operator new[](size_t size) { return operator new(size); }
+void operator delete(void * p) throw() { free(p); }
+void operator delete[](void * p) throw() { free(p); }
+void operator delete(void * p, size_t) throw() { free(p); }
+void operator delete[](void * p, size_t) throw() { free(p); }
+
+/// Instance under benchmark and the state its kernels work on
+struct bench_case
+{
+   cm_run * run;
+   cm_scratch * ws;
+   bay_t state;		//!< Bay before the first relocation
+   int h;		//!< Max height of a stack
+   int l;		//!< Block to be retrieved in \c state
+   int row;		//!< Stack of block \c l
+   long sink;		//!< Keeps the results of the kernels alive
+};
+
+typedef void (*kernel_t)(bench_case & c);
+
+void k_find_element(bench_case & c)
+{
+   int row, col;
+   for (int k = c.l; k <= c.run->nels; k++)
+      c.sink += find_element(k, c.state, row, col) ? row : 0;
+}
+
+void k_block_heuristic(bench_case & c)
+{
+   c.sink += block_heuristic(c.run->bay, c.run->m, c.h, c.run->nels, 1, c.ws->heur, NULL, INT_MAX, c.run->horizon_at(1));
+}
+
+void k_corridor(bench_case & c)
+{
+   c.run->define_stochastic_corridor(c.state, c.row, c.run->delta, c.run->constantV, c.h, *c.ws);
+   c.sink += c.ws->is_in_corridor[0];
+}
+
+void k_neighborhood(bench_case & c)
+{
+   c.sink += c.run->neighborhood_search(c.state, c.row, c.h, c.l, 0, *c.ws);
+}
+
+/// Timing of a kernel
+struct bench_result
+{
+   long ops;		//!< Operations performed
+   double ns;		//!< Time per operation (ns)
+   double alloc;	//!< Heap allocations per operation
+};
+
+/// Repeat \c k until \c budget seconds are spent (\c per_call operations per call)
+bench_result measure(kernel_t k, bench_case & c, long per_call, double budget)
+{
+   k(c);			// warm up (sizes the work spaces)
+
+   bench_result r;
+   long calls  = 0;
+   long alloc0 = n_alloc;
+   timer tTime;
+   double t    = 0;
+   for (long batch = 1; t < budget; batch *= 2)
+   {
+      for (long b = 0; b < batch; b++)
+	 k(c);
+      calls += batch;
+      t = tTime.elapsedTime(timer::REAL);
+   }
+   r.ops   = calls*per_call;
+   r.ns    = t*1.0E9/r.ops;
+   r.alloc = (double)(n_alloc - alloc0)/r.ops;
+   return r;
+}
+
+void report(ostream * csv, const string & name, const char * kernel, const bench_result & r, double rollouts)
+{
+   cout << setw(44) << name << setw(28) << kernel << setw(14) << fixed << setprecision(1) << r.ns
+      << setw(12) << setprecision(3) << r.alloc << setw(14) << setprecision(0) << rollouts << endl;
+   if (csv != NULL)
+      *csv << name << "," << kernel << "," << r.ops << "," << fixed << setprecision(1) << r.ns << ","
+	 << setprecision(4) << r.alloc << "," << setprecision(0) << rollouts << endl;
+}
+
+int main(int argc, char *argv[])
+{
+   double budget = 0.2;
+   int height    = -1;
+   int width     = 3;
+   long bseed    = 1;
+   int horizon   = 0;
+   const char * csv_file = NULL;
+   int i = 1;
+   for (; i + 1 < argc && argv[i][0] == '-'; i += 2)
+   {
+      if (argv[i][1] == 't')
+	 budget = atof(argv[i+1]);
+      else if (argv[i][1] == 'n')
+	 height = atoi(argv[i+1]);
+      else if (argv[i][1] == 'd')
+	 width = atoi(argv[i+1]);
+      else if (argv[i][1] == 's')
+	 bseed = atol(argv[i+1]);
+      else if (argv[i][1] == 'v')
+	 horizon = atoi(argv[i+1]);
+      else if (argv[i][1] == 'o')
+	 csv_file = argv[i+1];
+      else
+      {
+	 cout << "Usage: bench [-t seconds] [-n max_height] [-d width] [-s seed] [-v horizon] [-o file.csv] [instance ...]" << endl;
+	 return 1;
+      }
+   }
+
+   std::vector < string > names;
+   if (i == argc)
+      expand_instances("data.tar:data/data*-*-1.dat", names);
+   for (; i < argc; i++)
+      if (!expand_instances(argv[i], names))
+	 cerr << "No instance matches " << argv[i] << endl;
+
+   ofstream csv;
+   if (csv_file != NULL)
+   {
+      csv.open(csv_file, ios::out);
+      if (!csv)
+      {
+	 cerr << "Cannot open file " << csv_file << endl;
+	 return 1;
+      }
+      csv << "instance,kernel,ops,ns_per_op,allocs_per_op,rollouts_per_s" << endl;
+   }
+
+   cout << setw(44) << "instance" << setw(28) << "kernel" << setw(14) << "ns/op"
+      << setw(12) << "alloc/op" << setw(14) << "rollouts/s" << endl;
+   for (unsigned f = 0; f < names.size(); f++)
+   {
+      std::vector< std::vector<int> > stacks;
+      int nels;
+      if (!read_stacks(names[f].c_str(), stacks, nels))
+      {
+	 cerr << "Cannot read instance " << names[f] << endl;
+	 continue;
+      }
+      int H = 0;
+      for (unsigned s = 0; s < stacks.size(); s++)
+	 if ((int)stacks[s].size() > H)
+	    H = stacks[s].size();
+
+      cm_run run;
+      run.quiet     = true;
+      run.name      = names[f].c_str();
+      run.n         = (height < 0) ? H + 2 : height;
+      run.delta     = (width < (int)stacks.size()) ? width : -1;
+      run.constantV = 1;
+      run.n_threads = 1;
+      run.n_workers = 1;
+      run.tt_bits   = 0;
+      run.horizon   = horizon;
+      run.horizon_full = 2*horizon;
+      run.set_bay(stacks, nels);
+
+      cm_scratch ws(run.m, 1);
+      ws.rng.set_seed(bseed, 0);
+
+      bench_case c;
+      c.run   = &run;
+      c.ws    = &ws;
+      c.state = run.bay;
+      c.h     = run.n;
+      c.sink  = 0;
+      // retrieve the blocks that are already on top
+      int col;
+      for (c.l = 1; c.l <= nels; c.l++)
+      {
+	 find_element(c.l, c.state, c.row, col);
+	 if (col < c.state.size(c.row) - 1)
+	    break;
+	 c.state.pop(c.row);
+      }
+
+      ostream * out = csv_file != NULL ? &csv : NULL;
+      bench_result r = measure(k_find_element, c, nels - c.l + 1, budget);
+      report(out, names[f], "find_element", r, 0);
+      r = measure(k_block_heuristic, c, 1, budget);
+      report(out, names[f], "block_heuristic", r, 1.0E9/r.ns);
+      if (c.l > nels)
+	 continue;		// no relocation at all
+      r = measure(k_corridor, c, 1, budget);
+      report(out, names[f], "define_stochastic_corridor", r, 0);
+      r = measure(k_neighborhood, c, 1, budget);
+      int n_cand = 0;
+      for (int s = 0; s < run.m; s++)
+	 n_cand += ws.is_in_corridor[s];
+      report(out, names[f], "neighborhood_search", r, n_cand*1.0E9/r.ns);
+   }
+   return 0;
+}
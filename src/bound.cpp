@@ -0,0 +1,73 @@
+/*! \file bound.cpp
+  \brief Lower bounds on the number of relocations of a bay
+
+  A lower bound on the optimal number of relocations is used to stop the
+  search as soon as the incumbent is proven optimal (see
+  cm_run::stopping_criterion()).
+*/
+#include "bound.h"
+
+/// Blocking-block bound
+/** Every block placed above a smaller block must be relocated at least
+  once (Kim and Hong, 2006).
+  */
+int lb_blocking(const bay_t & bay)
+{
+    return bay.n_bad;
+}
+
+/// Look-ahead bound (blocking blocks plus unavoidable new blockings)
+/** The retrievals are simulated on a copy of the bay, in increasing order
+  of the blocks. When block \c k is retrieved, each block above it is
+  relocated (and counted once, as in lb_blocking()); if such a block is
+  larger than the minimum of every other stack, and larger than the
+  blocks relocated before it from the same stack, it is necessarily
+  placed above a smaller block and will be relocated once more (Zhu et
+  al., 2012).
+
+  The relocated blocks are then taken out of the bay rather than placed
+  somewhere: since only the blocks above the block to be retrieved are
+  ever relocated (as in the corridor method and in block_heuristic()),
+  this can only raise the minimum of the stacks, so the bound stays
+  valid. For the same reason, the height limit of the stacks is
+  ignored. The cost is O(\c nels x \c m).
+
+  The retrievals are simulated on \c node, which is overwritten (once it
+  has been sized for the bay, no memory is allocated).
+  */
+int lb_lookahead(const bay_t & bay, bay_t & node)
+{
+    node = bay;
+    int lb = node.n_bad;
+    int row, col;
+
+    for (int k = 1; k < (int)node.pos.size(); k++)
+    {
+        if (!node.locate(k, row, col))
+            continue;		// not in the bay (or taken out above)
+
+        int max_min = 0;	// largest minimum among the other stacks
+        for (int i = 0; i < node.m; i++)
+            if (i != row && node.min_el(i) > max_min)
+                max_min = node.min_el(i);
+
+        int max_above = 0;	// largest block relocated so far from row
+        while (node.size(row) > col + 1)
+        {
+            int el = node.pop(row);
+            if (el > max_min && el > max_above)
+                lb++;
+            if (el > max_above)
+                max_above = el;
+        }
+        node.pop(row);
+    }
+    return lb;
+}
+
+/// Look-ahead bound on a copy of \c bay (see lb_lookahead(const bay_t &, bay_t &))
+int lb_lookahead(const bay_t & bay)
+{
+    bay_t node;
+    return lb_lookahead(bay, node);
+}
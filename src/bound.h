@@ -0,0 +1,8 @@
+#ifndef bound_H
+#define bound_H
+#include "bay.h"
+
+int lb_blocking(const bay_t & bay);
+int lb_lookahead(const bay_t & bay);
+int lb_lookahead(const bay_t & bay, bay_t & node);
+#endif
@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   Copyright (C) 2008 by Marco Caserta                                   *
+ *   marco dot caserta at uni-hamburg dot de                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+/*! \file brpconv.cpp
+  \brief Converter between the text and the binary formats
+
+  A file in the binary format (instance or solution, see instance.cpp) is
+  written in the text format; a file in the text format is written in
+  the binary format, as an instance, or as a solution if -s is given.
+  Instances may also be members of tar archives (archive.tar:member).
+
+  Usage: brpconv [-s] input output
+*/
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include "bay.h"
+#include "instance.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+   bool solution = false;
+   int i = 1;
+   if (i < argc && strcmp(argv[i], "-s") == 0)
+   {
+      solution = true;
+      i++;
+   }
+   if (argc - i != 2)
+   {
+      cout << "Usage: brpconv [-s] input output" << endl;
+      return 1;
+   }
+   const char * in  = argv[i];
+   const char * out = argv[i+1];
+
+   int kind = file_kind(in);
+   if (kind < 0)
+   {
+      cerr << "Cannot open file " << in << endl;
+      return 1;
+   }
+   bool to_binary = (kind == 0);
+   if (kind == BIN_SOLUTION)
+      solution = true;
+   else if (kind == BIN_INSTANCE)
+      solution = false;
+
+   bool ok;
+   if (solution)
+   {
+      int m, nels, z;
+      std::vector < move_t > moves;
+      ok = read_solution(in, m, nels, z, moves) && write_solution(out, m, nels, z, moves, to_binary);
+   }
+   else
+   {
+      int nels;
+      std::vector < std::vector<int> > stacks;
+      ok = read_stacks(in, stacks, nels) && write_stacks(out, stacks, nels, to_binary);
+   }
+   if (!ok)
+   {
+      cerr << "Cannot convert " << in << " into " << out << endl;
+      return 1;
+   }
+   cout << in << " -> " << out << " (" << (to_binary ? "binary" : "text") << ")" << endl;
+   return 0;
+}
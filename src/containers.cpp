@@ -54,7 +54,9 @@ A mathematical formulation for the problem is :
 
 Parameters are read from command line. The following parameters can be defined:
 
-- -f : filename of data file
+- -f : filename of data file, or member of a tar archive given as
+archive.tar:member (e.g., data.tar:data/data3-3-1.dat), read without
+extracting the archive (see instance.cpp)
 - -d : horizontal corridor width (symmetric w.r.t. the stack in which the element
 to be removed is placed)
 - -c \f$ \in \left\{0, 1\right\} \f$, with the following meaning:
@@ -69,8 +71,49 @@ stack depends on the number of elements in the stack)
 parameter c. If c = 1, then n is used as maximum height of a stack;
 if c = 0, then n is used as the number of empty spots allowed on each
 stack
-- -t : CPU time limit for the algorithm (seconds). It stops after max time
+- -t : wall-clock time limit for the algorithm (seconds). It stops after max time
 limit is reached (no solution returned if the algorithm does not terminate)
+- -r : service mode. The solver keeps running and solves the bays sent on
+stdin ("-r -") or on the given Unix socket, replying with the moves of the
+best solution (see service.cpp). The options above are the defaults of each
+request
+- -u, -m, -i, -g, -l : further stopping policies (see stop.h), i.e., a cpu
+budget, a max number of trajectories, a max number of trajectories without
+improvement, a target value and whether to stop at the lower bound
+- -p : number of threads used to evaluate the moves of a neighborhood (the
+look-ahead of each candidate stack is run on a separate worker)
+- -w : number of trajectories built concurrently (each trajectory worker owns
+a copy of the bay; the incumbent is shared by all of them)
+- -b : batch mode. The jobs listed in the given manifest (instances, or glob
+patterns, times corridor widths and replications) are solved within a single
+process, see run_batch(). The options above are the defaults of each job
+- -j : number of batch jobs solved concurrently
+- -o : file the result rows of the batch mode are written to (default
+result.dat)
+- -s : seed of the random number generator. Each trajectory worker draws from
+its own stream of the seed (see rng.h), so that a run is reproduced by the
+same seed and number of workers. If not given, the seed is taken from the clock
+- -z : the look-ahead values are stored in a transposition table of 2^z
+entries shared by all the threads of a run (see ttable.h); 0 disables it
+- -e : search engine, either "cm" (corridor method, the default) or "ida",
+an exact IDA* search proving the optimal number of relocations (see
+exact.cpp). The exact engine runs on a single thread; it is meant for small
+and medium bays, solved in parallel in batch mode. A third engine, "beam",
+is a beam search (see cm_run::solve_beam()) whose candidates are evaluated
+by -p threads
+- -k : width of the beam (beam engine)
+- -x : the moves of the best solution are written to the given file, in the
+binary format of instance.cpp (see also brpconv)
+- -a : every improvement of the incumbent is traced to the given file, one
+row per improvement with the wall-clock and cpu time, the number of
+trajectories started and the new value (see cm_run::write_trace()). In
+batch mode the rows of all the jobs go to the same file
+
+If the code is compiled with W_STATS (see the Makefile and stats.h), the
+counters of the run (trajectories, neighborhoods, rollouts, corridor widths,
+time split and peak memory) are written as a JSON object next to the result
+file, i.e., to result.json (in batch mode, a JSON array with one object per
+job, in a file named after the -o file, see stats_file()).
 
 \section modification Project Modifications History
 \date 03.01.08 first version completed
@@ -86,10 +129,12 @@ function "define_stochastic_corridor()".
 In addition, I created a new data structure to keep track of the
 path leading to best solution. If the bay configurations, from the
 initial one to the empty bay, should be printed, activate the
-directive #W_OUT.
+directive #W_PATH.
 
-More precisely, two arrays of bays are created. Each solution is composed of 
-two parts: The relocations from 1 to k, and the heuristic (look ahead) relocations
+More precisely, two lists of moves are created (a move is either a
+relocation from one stack to another or a retrieval, see move_t; the
+bays along a path are only rebuilt, from the initial bay, when printed).
+Each solution is composed of two parts: The relocations from 1 to k, and the heuristic (look ahead) relocations
 from k to nEl. In other words, every time we try to relocate block "k", we evaluate
 the goodness of such a move with a look-ahead mechanism (a simple heuristic) that 
 tries to complete the solution from k+1 till the end. Thus, the objective 
@@ -97,7 +142,8 @@ function value of a solution is composed of a fixed number of relocations (from
 1 to k) and a heuristic-based (say, expected, or upper bound) number of relocations
 from k+1 onward. To account for these two portions, we use two data structures:
 - path : this is the path from the original bay to the current configuration. It 
-gets progressively enlarged as we move from 1 to nEl.
+gets progressively enlarged as we move from 1 to nEl. Each trajectory has its
+own path (see cm_scratch), since trajectories may be built concurrently.
 -heurPath : this is the second part of the solution, from k+1 to the end, as 
 suggested by the heuristic scheme.
 ==> bestPath provides the final path from the initial configuration to the empty
@@ -128,9 +174,24 @@ bay, with total number of relations equal to best_z.
 #include <cstdlib>
 #include <cmath>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <sstream>
+#include <algorithm>
 #include "timer.h"
+#include "rng.h"
 #include "options.h"
+#include "bay.h"
 #include "heuristic.h"
+#include "bound.h"
+#include "ttable.h"
+#include "exact.h"
+#include "instance.h"
+#include "pool.h"
+#include "containers.h"
+#include "solver.h"
 
 //#define M_DEBUG	/*!< Comment this to remove debug */
 #define W_OUT
@@ -144,47 +205,45 @@ const double _ZERO      = 0.0e0;			    //!< Double Zero
 const double _ONE       = 1.0e0;			    //!< Double One
 const double _EPSILON   = numeric_limits<float>::epsilon(); //!< Double \f$ \epsilon\f$ value
 const char* RESULT_FILE = "result.dat";
+const char* stop_message[] = { "the search is over", "the lower bound was reached",
+    "the target value was reached", "time limit was reached", "the cpu budget was spent",
+    "the max number of trajectories was reached", "no improvement was found for too long" }; //!< See stop.h
 /************************ Global Constants *******************/
 
 //==============================================================
-// Global Variables
+// Global Variables (files of the command line, see options.cpp; the
+// parameters of a run are kept in brp_options)
 //==============================================================
 char * _FILENAME;               //!< Data file (read from command line)
-std::vector< std::vector<int> > bay;
-std::vector < std::vector< std::vector<int> > > path;
-std::vector < std::vector< std::vector<int> > > bestPath;
-int * lambda;
-int m;				//!< Number of Stacks
-int n;				//!< Max height of each Stack
-int delta;			//!< Max horizontal width corridor
-int nels;			//!< Total number of blocks in the bay
-int constantV;			//!< Vertical corridor type (1 : constant; 0 : variable)
-int best_z;			//!< Objective function value of best solution
-double best_time;		//!< Time to best solution
-int time_limit;			//!< Max time allowed
-timer tTime;			//!< Ojbect clock to measure REAL and VIRTUAL (cpu) time
+char * _BATCHFILE;              //!< Batch manifest (read from command line)
+const char * _OUTFILE;          //!< Output file of the batch mode
+char * _SOLFILE;                //!< Output file of the best solution
+char * _TRACEFILE;              //!< Output file of the anytime trace
+char * _SERVICE;                //!< Endpoint of the service mode (- : stdin)
+char * _STARTFILE;              //!< Solution of the instance before the changes (warm start)
+char * _CHANGEFILE;             //!< Changes of the bay applied to the instance
+int n_jobs;			//!< Number of batch jobs solved concurrently
 //==============================================================
-void read_problem_data();	
-void printing_parameters();	
-int stopping_criterion();	
-void print_bay(std::vector< std::vector<int> > bay);
-bool found_element(int l, std::vector < std::vector <int> > node, int & row, int & col);
-void update_best(int z, std::vector< std::vector<int> > bay, std::vector < std::vector< std::vector<int> > > path, std::vector < std::vector< std::vector<int> > > heurPath);
-void define_stochastic_corridor(std::vector< std::vector <int> > state, int row, int * lambda, int delta, int constantV, bool * is_in_corridor, int h);
-void normalize_scores(bool * is_in_corridor, int target, double * score_stack);
-int  neighborhood_search(std::vector< std::vector <int> > state, int row, int h, int l, int z_cum);
+
+bool found_element(int l, const bay_t & node, int & row, int & col);
 void weight_assignment(double & w1, double & w2, double & w3, double tot_mins1, double tot_mins2, int n_empty_stacks);
-void search_trajectory();
+void evaluate_candidate(int task, int worker, void * arg);
+void run_trajectory_worker(int task, int worker, void * arg);
+int  run_batch(const brp_options & opt);
+std::string stats_file(const char * result_file);
+bool exact_stop(void * arg);
+void expand_state(int task, int worker, void * arg);
 //===========================================================
 //23456789012345678901234567890123456789012345678901234567890
 //===========================================================
+#ifndef CM_NO_MAIN
 /// Main Program for Containers Terminal Relocation
 /** Overall description of the algorithm goes here.
 */
 int main(int argc, char *argv[])
 {
-
-    int err = parseOptions(argc, argv);
+    brp_options opt;
+    int err = parseOptions(argc, argv, opt);
     if ( err != 0)
     {
         if (err != -1)
@@ -192,6 +251,15 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+    if (opt.seed < 0)
+        opt.seed = time(0);
+    opt.tracing = (_TRACEFILE != NULL);
+
+    if (_BATCHFILE != NULL)
+        return run_batch(opt);
+    if (_SERVICE != NULL)
+        return run_service(opt, _SERVICE);
+
     ofstream fResult(RESULT_FILE, ios::out);
     if (!fResult)
     {
@@ -199,94 +267,575 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
-    int random_seed = time(0);
-    srand(random_seed);
-    best_z = _MAXRANDOM;
+    brp_instance inst;
+    if (!inst.read(_FILENAME))
+    {
+        cerr << "Cannot read instance " << _FILENAME << endl;
+        exit(1);
+    }
+    int start_m, start_nels, start_z;
+    std::vector < move_t > start;
+    if (_STARTFILE != NULL && (!read_solution(_STARTFILE, start_m, start_nels, start_z, start)
+            || !solution_plan(inst.stacks, start, inst.start)))
+    {
+        cerr << "Cannot read a solution of " << _FILENAME << " from file " << _STARTFILE << endl;
+        exit(1);
+    }
+    std::vector < bay_change > changes;
+    if (_CHANGEFILE != NULL && (!read_changes(_CHANGEFILE, changes) || !apply_changes(inst.stacks, inst.nels, changes, &inst.start)))
+    {
+        cerr << "Cannot apply the changes of file " << _CHANGEFILE << endl;
+        exit(1);
+    }
+    brp_solver solver(opt);
+    brp_result res = solver.solve(inst);
 
-    read_problem_data();
+    write_result(fResult, opt, res);
+    fResult.close();
+#ifdef W_STATS
+    std::string fname = stats_file(RESULT_FILE);
+    ofstream fStats(fname.c_str(), ios::out);
+    if (!fStats)
+        cerr << "Cannot open file " << fname << endl;
+    write_stats(fStats, opt, res);
+    fStats << endl;
+#endif
+    if (_SOLFILE != NULL && !write_solution(_SOLFILE, res.m, res.nels, res.z, res.moves, true))
+        cerr << "Cannot open file " << _SOLFILE << endl;
+    if (opt.tracing)
+    {
+        ofstream fTrace(_TRACEFILE, ios::out);
+        if (!fTrace)
+            cerr << "Cannot open file " << _TRACEFILE << endl;
+        write_trace(fTrace, opt, res);
+    }
+    
 #ifdef W_OUT
-    printing_parameters();
+    if (res.optimal && (res.stop_reason == STOP_LB || res.stop_reason == STOP_NONE))
+        cout <<"Algorithm terminates because the lower bound was reached. Optimal solution requires " << res.z << " relocations." << endl;
+    else if (res.z == _MAXRANDOM)
+        cout <<"Algorithm terminates because " << stop_message[res.stop_reason] << ". No solution found within the height limit (lower bound " << res.lb << ")." << endl;
+    else
+        cout <<"Algorithm terminates because " << stop_message[res.stop_reason] << ". Best solution found requires " << res.z << " relocations (lower bound " << res.lb << ")." << endl;
+    if (opt.engine == ENGINE_IDA)
+        cout << "Nodes explored :: " << res.nodes << endl;
+    else if (opt.engine == ENGINE_BEAM)
+        cout << "Beam states expanded :: " << res.nodes << " (width " << opt.beam_width << ")" << endl;
+    else
+        cout << "Trajectories started :: " << res.trajectories << " (" << opt.n_workers << " workers)" << endl;
+    if (opt.engine != ENGINE_IDA && opt.tt_bits > 0)
+        cout << "Transposition table  :: " << res.tt_hits << " hits out of " << res.tt_probes << " look-ups ("
+            << setprecision(3) << ((res.tt_probes > 0) ? 100.0*res.tt_hits/res.tt_probes : 0.0) << "%)" << endl;
 #endif
-    tTime.resetTime();		// start clock
+    if (res.z == _MAXRANDOM)
+        cout << "CM : No solution found." << endl;
+    else
+        cout << "CM : Solution found with " << res.z << " moves." << endl;	
+
+    return 0;
+}
+#endif
+//===========================================================
+//234567890123456789 FUNCTIONS 123456789012345678901234567890
+//===========================================================
+
+/// Run with the parameters \c opt (the bay is set by set_bay())
+cm_run::cm_run(const brp_options & opt) : name(""), start_z(-1), m(0), nels(0), lb(0), best_z(_MAXRANDOM),
+    best_time(0), n_trajectories(0), last_improvement(0), stop_reason(STOP_NONE), tt_probes(0),
+    tt_hits(0), n_nodes(0), run_time(0), workers(NULL)
+{
+    configure(opt);
+}
+
+cm_run::~cm_run()
+{
+    delete workers;
+    for (unsigned w = 0; w < scratch.size(); w++)
+        delete scratch[w];
+}
+
+/// Set the parameters of the run (before set_bay(), the run may be solved again)
+void cm_run::configure(const brp_options & opt)
+{
+    n          = opt.n;
+    delta      = opt.delta;
+    constantV  = opt.constantV;
+    n_threads  = (opt.n_threads > 1) ? opt.n_threads : 1;	// as in task_pool
+    n_workers  = (opt.n_workers > 1) ? opt.n_workers : 1;
+    stop       = opt.stop;
+    seed       = opt.seed;
+    tt_bits    = opt.tt_bits;
+    engine     = opt.engine;
+    beam_width = opt.beam_width;
+    horizon    = opt.horizon;
+    horizon_full = (opt.horizon_full >= 0) ? opt.horizon_full : 2*opt.horizon;
+    quiet      = opt.quiet;
+    tracing    = opt.tracing;
+}
 
-    bestPath.push_back(bay); // copy initial configuration
+/// Trajectory worker \c task of the run \c arg (see cm_run::trajectory_worker())
+void run_trajectory_worker(int task, int /* worker */, void * arg)
+{
+    ((cm_run *)arg)->trajectory_worker(task);
+}
 
-    while(!stopping_criterion())
+/// Set up the trajectory workers and their work spaces
+/** The threads and the work spaces of a previous solve are kept, unless
+  the number of workers or of threads has changed or the bay has more
+  stacks than the work spaces were sized for.
+  */
+void cm_run::prepare()
+{
+    bool fits = ((int)scratch.size() == n_workers);
+    for (unsigned w = 0; fits && w < scratch.size(); w++)
+        fits = (scratch[w]->m_max >= m && (int)scratch[w]->tt_probes.size() == (n_threads > 1 ? n_threads : 1));
+    if (!fits)
+    {
+        for (unsigned w = 0; w < scratch.size(); w++)
+            delete scratch[w];
+        scratch.clear();
+        for (int w = 0; w < n_workers; w++)
+            scratch.push_back(new cm_scratch(m, n_threads));
+    }
+    if (workers != NULL && workers->size() != n_workers)
     {
-        search_trajectory(); 
-        // print_bay(bay);
+        delete workers;
+        workers = NULL;
     }
+    if (workers == NULL && n_workers > 1)
+        workers = new task_pool(n_workers);
+}
 
-    fResult << setw(12) << _FILENAME << setw(4) << m << setw(4) << n << setw(4) 
-        << nels << setw(12) << best_z << setw(10)
-        << delta << setw(15) << setprecision(3) 
-        << best_time << endl;
-    fResult.close();
-    
+/// Build trajectories until the stopping criterion is met
+/** The trajectory workers (the threads of \c workers, the calling
+  thread being worker 0) share the incumbent solution of the run, which is
+  reset before starting. The threads, the work spaces and the
+  transposition table are set up by the first solve and kept for the next
+  ones (see prepare() and ttable::init()).
+  */
+void cm_run::solve()
+{
+    best_z = _MAXRANDOM;
+    best_time = 0;
+    bestPath.clear();
+    start_z = -1;
+    n_trajectories = 0;
+    last_improvement = 0;
+    stop_reason = STOP_NONE;
+    n_nodes = 0;
+    tt.init(tt_bits);
+    tt_probes = 0;
+    tt_hits = 0;
+    stats.clear();
+    trace.clear();
+    if (tracing)
+        trace.reserve(256);
+    tTime.resetTime();		// start clock
+    t_start = tick();
+#ifdef W_OUT
+    if (!quiet)
+        printing_parameters();
+#endif
+    if (!start.empty() && engine != ENGINE_IDA)
+        warm_start();
+
+    if (engine == ENGINE_IDA)
+        solve_exact();
+    else if (engine == ENGINE_BEAM)
+        solve_beam();
+    else
+    {
+        prepare();
+        if (workers != NULL)
+            workers->run(n_workers, run_trajectory_worker, this);
+        else
+            trajectory_worker(0);
+    }
+    run_time = wall_time();
 #ifdef W_PATH
-    cout << "Initial configuration and BEST PATH is :: " << endl;
-    cout << "==================================================" << endl;  
-    print_bay(bestPath[0]);
-    cout << "==================================================" << endl;  
-    for (int k = 1; k < bestPath.size(); k++) 
-        print_bay(bestPath[k]);
+    if (!quiet)
+    {
+        cout << "Initial configuration and BEST PATH is :: " << endl;
+        cout << "==================================================" << endl;  
+        print_path(bay, bestPath);
+    }
 #endif
+}
+
+/// Repair the previous solution (\c start) into the first incumbent
+/** The bay of the run is the previous one changed by a few retrievals,
+  arrivals or new priorities (see apply_changes()): most relocations of
+  the previous solution still make sense, and the repaired solution (see
+  repair_solution()) is usually close to the best one. The search then
+  starts with this upper bound, so that the trajectories (or beam states)
+  not better than the repaired solution are fathomed from the outset, and
+  the run may even stop at once if the repaired solution meets the lower
+  bound. The exact engine does not use it. If the solution cannot be
+  repaired (a block of the numbering is missing from the bay), the run
+  starts cold, \c start_z being -1.
+  */
+void cm_run::warm_start()
+{
+    int h = (constantV == 1) ? n : bay.size(0) + n;	// as in build_trajectory()
+    bay_t state = bay;
+    heur_scratch hs(m);
+    std::vector < move_t > path;
+    start_z = repair_solution(state, m, h, nels, start, hs, path);
+    if (start_z < 0)
+        return;		// not a solution of this bay: cold start
+
+    std::lock_guard<std::mutex> lock(best_mutex);
+    best_time = elapsed_time();
+    best_z    = start_z;
+    bestPath.swap(path);
+    trace_improvement();
 #ifdef W_OUT
-    cout <<"Algorithm terminates because time limit was reached. Best solution found requires " << best_z << " relocations." << endl;
+    if (!quiet)
+        cout << "***  Warm start z :: " << best_z << endl;
 #endif
-    cout << "CM : Solution found with " << best_z << " moves." << endl;	
+}
 
-    return 0;
+/// Stopping test of the exact engine (see ida_search())
+bool exact_stop(void * arg)
+{
+    return ((cm_run *)arg)->stopping_criterion();
 }
-//===========================================================
-//234567890123456789 FUNCTIONS 123456789012345678901234567890
-//===========================================================
 
-/// Read instance file
-/** The structure of the instance file is:
-  - row 1 : number_of_stack (\c m) total_number_of_blocks (\c nels)
-  - rows 2 to \c m + 1 : number_of_blocks in stack ... list of blocks in stack
-  - EOF
+/// Solve the run with the exact engine (see exact.cpp)
+/** The solution of block_heuristic() is the first incumbent, and the
+  initial upper bound of the search; the incumbent (and its time) only
+  changes if the search finds a better solution. The lower bound of the
+  run is raised to the one proven by the search, i.e., to the value of
+  the solution if the search is completed within the time limit.
   */
-void read_problem_data()
+void cm_run::solve_exact()
 {
-    int temp, n_el;
+    int h = (constantV == 1) ? n : bay.size(0) + n;	// as in build_trajectory()
+    bay_t state = bay;
+    heur_scratch hs(m);
+    bestPath.clear();
+    int z_heur = block_heuristic(state, m, h, nels, 1, hs, &bestPath, _MAXRANDOM);
+    if (z_heur < _MAXRANDOM)
+    {
+        best_z    = z_heur;
+        best_time = elapsed_time();
+        trace_improvement();
+    }
+    else
+        bestPath.clear();	// infeasible rollout: no incumbent yet
 
-    ifstream fdata(_FILENAME, ios::in);
-    if (!fdata)
+    int lb_ida;
+    long nodes;
+    int z = ida_search(bay, h, nels, best_z, bestPath, lb_ida, nodes, exact_stop, this);
+    n_nodes = nodes;
+    if (z < best_z)
     {
-        cerr << "Cannot open file " << _FILENAME << endl;
-        exit(1);
+        best_time = elapsed_time();
+        best_z    = z;
+        trace_improvement();
+    }
+    if (lb_ida > lb)
+        lb = lb_ida;
+#ifdef W_OUT
+    if (!quiet)
+        cout << "***  After " << setw(8) << setprecision(3) << best_time << " seconds z :: " << best_z << endl;
+#endif
+}
+
+/// Partial solution kept in the beam
+struct beam_state
+{
+    bay_t bay;			//!< Bay reached
+    std::vector < move_t > path; //!< Moves from the initial bay
+    int l;			//!< Next block to be retrieved
+    int z;			//!< Relocations performed
+};
+
+/// Relocation of the block on top of the next block to be retrieved of a beam state
+struct beam_child
+{
+    int parent;			//!< Beam state the relocation is applied to
+    int to;			//!< Stack the block is relocated onto (-1 : not a candidate)
+    int value;			//!< Relocations performed plus look-ahead value
+    uint64_t hash;		//!< Hash of the bay after the relocation
+};
+
+/// A level of the beam, expanded by the workers of a pool (see expand_state())
+struct beam_job
+{
+    cm_run * run;
+    std::vector < beam_state > * beam;
+    std::vector < beam_child > * child;	//!< m slots per beam state
+    int h;			//!< Max height of a stack
+    std::vector < heur_scratch * > heur;	//!< Heuristic work space of each worker
+    std::vector < long > tt_probes;	//!< Transposition table look-ups of each worker
+    std::vector < long > tt_hits;	//!< Transposition table hits of each worker
+};
+
+/// Compare two children of a beam level (by value, ties broken by position)
+struct beam_order
+{
+    const std::vector < beam_child > * child;
+    bool operator()(int a, int b) const
+    {
+        int va = (*child)[a].value, vb = (*child)[b].value;
+        return (va < vb) || (va == vb && a < b);
+    }
+};
+
+/// Retrieve the blocks of beam state \c s that are on top of their stack
+/** \return false if the bay is empty */
+static bool retrieve_top(beam_state & s)
+{
+    int row, col;
+    while (s.l < (int)s.bay.pos.size() && s.bay.locate(s.l, row, col))
+    {
+        if (col < s.bay.size(row) - 1)
+            return true;
+        s.bay.pop(row);
+        move_t mv = { row, -1 };
+        s.path.push_back(mv);
+        s.l++;
+    }
+    return false;
+}
+
+/// Evaluate the children of beam state \c task on \c worker
+/** The block on top of the next block to be retrieved is relocated onto
+  each stack below the height limit (only the first empty stack is
+  tried), the look-ahead value of the bay is computed (see
+  cm_run::look_ahead()) and the move is undone. Each task only touches
+  the bay of its own state.
+
+  The stopping criterion is polled before each rollout, so that a level
+  of a large bay does not outlast the time limit; the task then returns
+  at once, leaving the level incomplete (see cm_run::solve_beam()).
+  */
+void expand_state(int task, int worker, void * arg)
+{
+    beam_job * job    = (beam_job *)arg;
+    cm_run * run      = job->run;
+    beam_state & s    = (*job->beam)[task];
+    beam_child * child = &(*job->child)[task*run->m];
+    bay_t & node      = s.bay;
+    int row, col;
+    bool empty_taken  = false;
+
+    node.locate(s.l, row, col);
+    for (int i = 0; i < run->m; i++)
+    {
+        child[i].parent = task;
+        child[i].to     = -1;
+        if (i == row || node.size(i) >= job->h)
+            continue;
+        if (node.size(i) == 0)
+        {
+            if (empty_taken)
+                continue;
+            empty_taken = true;
+        }
+        if (run->stopping_criterion())
+            return;
+        node.move(row, i);
+        int value = run->look_ahead(node, job->h, s.l, *job->heur[worker], _MAXRANDOM,
+            job->tt_probes[worker], job->tt_hits[worker]);
+        if (value < _MAXRANDOM)		// else infeasible: not a candidate
+        {
+            child[i].to    = i;
+            child[i].hash  = node.hash;
+            child[i].value = s.z + 1 + value;
+        }
+        node.move(i, row);
+    }
+}
+
+/// Solve the run with a beam search
+/** Rather than committing to one relocation at a time along a single
+  trajectory, the \c beam_width best partial solutions are kept at each
+  level, a level being one relocation (the retrievals in between are
+  performed as soon as possible). Every relocation of the block on top of
+  the next block to be retrieved is evaluated for each state of the
+  beam, in parallel on -p threads, and ranked by the relocations
+  performed plus its look-ahead value, i.e., the value of the complete
+  solution found by block_heuristic(). The best children, deduplicated by
+  the hash of their bay, make up the next level; children which cannot
+  improve the incumbent are dropped.
+
+  The first incumbent (unless the run is warm started) is the solution of
+  block_heuristic() on the initial bay, which is then updated with the
+  best child of each level (with a rollout horizon, only once the values
+  are exact, see horizon_at()). The
+  search is over when the beam is empty or when the stopping criterion is
+  met; the criterion is also polled during the expansion of a level (see
+  expand_state()), whose partial children are then dropped.
+  The beam being deterministic, the result does not depend on the number
+  of threads.
+  */
+void cm_run::solve_beam()
+{
+    int h = (constantV == 1) ? n : bay.size(0) + n;	// as in build_trajectory()
+    std::vector < beam_state > beam(1), next;
+    std::vector < beam_child > child;
+    std::vector < int > order;
+    std::vector < uint64_t > taken;
+
+    beam[0].bay = bay;
+    beam[0].l   = 1;
+    beam[0].z   = 0;
+    if (!retrieve_top(beam[0]))
+    {
+        best_z = 0;
+        best_time = elapsed_time();
+        bestPath = beam[0].path;
+        trace_improvement();
+        return;
+    }
+
+    if (best_z == _MAXRANDOM)
+    {
+        // first incumbent, in case the first level is interrupted
+        heur_scratch hs(m);
+        std::vector < move_t > heurPath;
+        int z = block_heuristic(beam[0].bay, m, h, nels, beam[0].l, hs, &heurPath, _MAXRANDOM);
+        if (z < _MAXRANDOM)
+        {
+            best_z    = z;
+            best_time = elapsed_time();
+            bestPath  = beam[0].path;
+            bestPath.insert(bestPath.end(), heurPath.begin(), heurPath.end());
+            trace_improvement();
+        }
     }
 
-    fdata >> m;		// number of stacks
+    task_pool pool(n_threads);
+    beam_job job;
+    job.run  = this;
+    job.h    = h;
+    job.beam = &beam;
+    job.child = &child;
+    for (int w = 0; w < pool.size(); w++)
+        job.heur.push_back(new heur_scratch(m));
+    job.tt_probes.resize(pool.size(), 0);
+    job.tt_hits.resize(pool.size(), 0);
+    beam_order cmp = { &child };
+
+    while (!beam.empty() && !stopping_criterion())
+    {
+        child.resize(beam.size()*m);
+        pool.run(beam.size(), expand_state, &job);
+        if (stop_reason != STOP_NONE)
+            break;		// level interrupted: keep the incumbent
+        n_nodes += beam.size();
+
+        order.clear();
+        for (unsigned c = 0; c < child.size(); c++)
+            if (child[c].to >= 0)
+                order.push_back(c);
+        std::sort(order.begin(), order.end(), cmp);
+
+        if (!order.empty() && child[order[0]].value < best_z
+            && horizon_at(beam[child[order[0]].parent].l) == 0)
+        {
+            // play the heuristic again (to the end), recording the path
+            const beam_child & c = child[order[0]];
+            beam_state & s       = beam[c.parent];
+            int row, col;
+            s.bay.locate(s.l, row, col);
+            std::vector < move_t > heurPath;
+            s.bay.move(row, c.to);
+            int z_heur = block_heuristic(s.bay, m, h, nels, s.l, *job.heur[0], &heurPath, _MAXRANDOM);
+            s.bay.move(c.to, row);
+            move_t mv = { row, c.to };
+            update_best(s.z + 1 + z_heur, s.path, mv, heurPath);
+        }
+
+        // next level
+        next.clear();
+        taken.clear();
+        for (unsigned k = 0; k < order.size() && (int)next.size() < beam_width; k++)
+        {
+            const beam_child & c = child[order[k]];
+            const beam_state & s = beam[c.parent];
+            if (std::find(taken.begin(), taken.end(), c.hash) != taken.end())
+                continue;
+            taken.push_back(c.hash);
+
+            next.push_back(s);
+            beam_state & t = next.back();
+            int row, col;
+            t.bay.locate(t.l, row, col);
+            t.bay.move(row, c.to);
+            move_t mv = { row, c.to };
+            t.path.push_back(mv);
+            t.z++;
+            // complete, or no better than the incumbent
+            if (!retrieve_top(t) || t.z + t.bay.n_bad >= best_z)
+                next.pop_back();
+        }
+        beam.swap(next);
+    }
+
+    for (int w = 0; w < pool.size(); w++)
+    {
+        tt_probes += job.tt_probes[w];
+        tt_hits   += job.tt_hits[w];
+        stats.rollouts       += job.heur[w]->n_rollouts;
+        stats.rollout_relocs += job.heur[w]->n_relocs;
+        delete job.heur[w];
+    }
+}
+
+/// File the counters are written to, next to \c result_file (result.dat -> result.json)
+std::string stats_file(const char * result_file)
+{
+    std::string fname = result_file;
+    size_t dot   = fname.rfind('.');
+    size_t slash = fname.rfind('/');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        fname.erase(dot);
+    return fname + ".json";
+}
+
+/// Set the initial bay of the run
+void cm_run::set_bay(const std::vector< std::vector<int> > & stacks, int nels_)
+{
+    m    = stacks.size();	// number of stacks
+    nels = nels_;		// total number of elements
     if (delta == m) // if corridor width is equal to bay width, deactivate CM
         delta = -1;
-    fdata >> nels;	// total number of elements
 
-    std::vector<int> temp_vector;
+    // the capacity of each stack is the max height allowed by the vertical
+    // corridor (see search_trajectory()), or the initial height if larger
+    int cap = (constantV == 1) ? n : stacks[0].size() + n;
+    int max_el = nels;
     for (int i = 0; i < m; i++)
     {
-        fdata >> n_el;
-        for (int j = 0; j < n_el; j++)
-        {
-            fdata >> temp;
-            temp_vector.push_back(temp);
-        }      
-        bay.push_back(temp_vector);
-        temp_vector.clear();
+        if ((int)stacks[i].size() > cap)
+            cap = stacks[i].size();
+        for (unsigned j = 0; j < stacks[i].size(); j++)
+            if (stacks[i][j] > max_el)
+                max_el = stacks[i][j];
     }
-    fdata.close();
+
+    bay = bay_t(m, cap, max_el);
+    for (int i = 0; i < m; i++)
+        for (unsigned j = 0; j < stacks[i].size(); j++)
+            bay.push(i, stacks[i][j]);
+
+    lb = lb_blocking(bay);
+    int lb_la = lb_lookahead(bay);
+    if (lb_la > lb)
+        lb = lb_la;
 }
 
 
 /// Print algorithmic parameters.
-void printing_parameters()
+void cm_run::printing_parameters()
 {
     cout << "=========================================" << endl;
     cout << "* DYNA CONTAINERS v. 4.0.0              *" << endl;
     cout << "*                                       *" << endl;
-    cout << "* Instance       : " << setw(20) << _FILENAME << setw(2) << "*" << endl;
+    cout << "* Instance       : " << setw(20) << name << setw(2) << "*" << endl;
     cout << "* No. Containers : " << setw(20) << nels << setw(2) << "*" << endl;
     cout << "* No. Stacks     : " << setw(20) << m << setw(2) << "*" << endl;
     cout << "* Type Vertical  : " << setw(20);
@@ -297,7 +846,24 @@ void printing_parameters()
     cout << setw(2) << "*" << endl;
     cout << "* Max Height     : " << setw(20) << n << setw(2) << "*" << endl;
     cout << "* Max Width      : " << setw(20) << delta << setw(2) << "*" << endl;
-    cout << "* Max Time       : " << setw(20) << time_limit << setw(2) << "*" << endl;
+    cout << "* Max Time       : " << setw(20) << stop.wall << setw(2) << "*" << endl;
+    if (stop.cpu > 0)
+        cout << "* Max Cpu Time   : " << setw(20) << stop.cpu << setw(2) << "*" << endl;
+    if (stop.trajectories > 0)
+        cout << "* Max Trajectory : " << setw(20) << stop.trajectories << setw(2) << "*" << endl;
+    if (stop.stall > 0)
+        cout << "* Max Stall      : " << setw(20) << stop.stall << setw(2) << "*" << endl;
+    if (stop.target >= 0)
+        cout << "* Target Value   : " << setw(20) << stop.target << setw(2) << "*" << endl;
+    cout << "* Threads        : " << setw(20) << n_threads << setw(2) << "*" << endl;
+    cout << "* Trajectory Wrk : " << setw(20) << n_workers << setw(2) << "*" << endl;
+    cout << "* Engine         : " << setw(20) << ((engine == ENGINE_IDA) ? "IDA*" : (engine == ENGINE_BEAM) ? "Beam" : "CM") << setw(2) << "*" << endl;
+    if (engine == ENGINE_BEAM)
+        cout << "* Beam Width     : " << setw(20) << beam_width << setw(2) << "*" << endl;
+    if (horizon > 0)
+        cout << "* Rollout Horizon: " << setw(20) << horizon << setw(2) << "*" << endl;
+    cout << "* Seed           : " << setw(20) << seed << setw(2) << "*" << endl;
+    cout << "* Lower Bound    : " << setw(20) << lb << setw(2) << "*" << endl;
     cout << "*                                       *" << endl;
     cout << "=========================================" << endl;
     cout << "* MC 2008 (c) -  UNI-HAMBURG            *" << endl;
@@ -306,78 +872,180 @@ void printing_parameters()
 
 /// Define stopping criterion for the algorithm
 /** The algorithm stops whenever one of the following 
-  conditions is reached:
-  1. time limit is reached (wall-clock time)
+  conditions is reached (see stop.h):
+  1. the best solution matches the lower bound, i.e., it is optimal
+  2. the best solution reaches the target value
+  3. the wall-clock deadline is reached (see wall_time())
+  4. the cpu budget is spent (see cpu_time())
+
+  The incumbent is checked at every call, the clocks only when the
+  countdown of the calling thread is over (see clock_countdown). Once met,
+  the reason is kept in \c stop_reason and every later call, from any
+  thread, returns at once. The limits on the trajectories are checked when
+  a trajectory is started (see start_trajectory()).
+  */
+int cm_run::stopping_criterion()
+{
+    static thread_local clock_countdown countdown;
+
+    if (stop_reason != STOP_NONE)
+        return true;
+    int reason = STOP_NONE;
+    int z      = best_z;
+    if (stop.at_lb && z <= lb)
+        reason = STOP_LB;
+    else if (z <= stop.target)
+        reason = STOP_TARGET;
+    else if (countdown.due())
+    {
+        if (stop.wall > 0 && wall_time() >= stop.wall)
+            reason = STOP_WALL;
+        else if (stop.cpu > 0 && cpu_time() >= stop.cpu)
+            reason = STOP_CPU;
+    }
+    if (reason == STOP_NONE)
+        return false;
+    int none = STOP_NONE;
+    stop_reason.compare_exchange_strong(none, reason);
+    return true;
+}
+
+/// Start a new trajectory, unless the run is over
+/** Besides the stopping criterion, the limits on the number of
+  trajectories started, overall or since the last improvement, are
+  checked here, so that a trajectory is never interrupted by them.
   */
-int stopping_criterion()
+bool cm_run::start_trajectory()
 {
-    return (tTime.elapsedTime(timer::VIRTUAL) >= time_limit);
+    if (stopping_criterion())
+        return false;
+    long k = n_trajectories++;
+    int reason = STOP_NONE;
+    if (stop.trajectories > 0 && k >= stop.trajectories)
+        reason = STOP_TRAJECTORIES;
+    else if (stop.stall > 0 && k - last_improvement >= stop.stall)
+        reason = STOP_STALL;
+    if (reason == STOP_NONE)
+        return true;
+    n_trajectories--;
+    int none = STOP_NONE;
+    stop_reason.compare_exchange_strong(none, reason);
+    return false;
 }
 
+/// Cpu time spent since the beginning of the search
+/** The cpu time of the thread running the search if it is the only one
+  (see elapsed_time()), that of the whole process otherwise.
+  */
+double cm_run::cpu_time()
+{
+    return tTime.elapsedTime((n_threads > 1 || n_workers > 1) ? timer::VIRTUAL : timer::THREAD);
+}
 
-/// Print bay on screen
-void print_bay(std::vector< std::vector <int> > bay)
+/// Time elapsed since the beginning of the search
+/** CPU time of the thread running the search is used when the algorithm
+  runs on a single thread (this is also correct when several runs share
+  the process, see run_batch()). Otherwise, since the CPU time of all the
+  threads adds up, wall-clock time is used.
+  */
+double cm_run::elapsed_time()
 {
-    std::vector < int>::iterator sIt;
+    if (n_threads > 1 || n_workers > 1)
+        return tTime.elapsedTime(timer::REAL);
+    return tTime.elapsedTime(timer::THREAD);
+}
+
 
+/// Print bay on screen
+void cm_run::print_bay(const bay_t & bay)
+{
     for (int i = 0; i < m; i++)
     {
         cout << "stack " << setw(3) << i << setw(2) << "|";
-        for (sIt = bay[i].begin(); sIt != bay[i].end(); sIt++)
-            cout << setw(4) << *sIt;
+        for (int j = 0; j < bay.size(i); j++)
+            cout << setw(4) << bay.at(i, j);
         cout << endl;
     }
     cout << endl;
 
 }
 
-bool found_element(int l, std::vector < std::vector <int> > node, int & row, 
-        int & col)
+/// Find stack \c row and tier \c col of block \c l (via the position index of the bay)
+bool found_element(int l, const bay_t & node, int & row, int & col)
 {
-    bool found = false;
-    row = -1;
-    col = -1;
-    for (int i = 0; i < node.size(); i++) 
-    {
-        for (int j = 0; j < node[i].size(); j++) 
-        {
-            if (node[i][j] == l)
-            {
-                found = true;
-                row = i;
-                col = j;
-                break;
-            }
-        }
-        if (found) break;
+    return node.locate(l, row, col);
+}
 
+/// Print the bays along a path, rebuilt by replaying its moves
+/** The initial bay is printed first, followed by the bay obtained after
+  each retrieval.
+  */
+void cm_run::print_path(const bay_t & bay, const std::vector < move_t > & moves)
+{
+    bay_t node = bay;
+    print_bay(node);
+    cout << "==================================================" << endl;  
+    for (unsigned k = 0; k < moves.size(); k++) 
+    {
+        node.apply(moves[k]);
+        if (moves[k].to < 0)
+            print_bay(node);
     }
-    return found; 
 }
 
 /// Update best objective function value
-void update_best(int z, std::vector< std::vector<int> > bay, 
-        std::vector < std::vector< std::vector<int> > > path, 
-        std::vector < std::vector< std::vector<int> > > heurPath)
+/** The best path is made up by the moves of the current trajectory
+  (\c path), the relocation \c mv under evaluation and the moves
+  suggested by the heuristic from there on (\c heurPath).
+
+  Trajectory workers read \c best_z without locking (it is atomic), while
+  updates are serialized by \c best_mutex: the value is checked again
+  under the lock, so that a worker never overwrites a better solution
+  published in the meantime by another worker.
+  */
+void cm_run::update_best(int z, const std::vector < move_t > & path, const move_t & mv,
+        const std::vector < move_t > & heurPath)
 {
+    std::lock_guard<std::mutex> lock(best_mutex);
+    if (z >= best_z)
+        return;
+    best_time = elapsed_time();
     best_z = z;
-    best_time = tTime.elapsedTime(timer::VIRTUAL);
+    last_improvement = (long)n_trajectories;
+    trace_improvement();
 #ifdef W_OUT
-    cout << "***  After " << setw(8) << setprecision(3) << best_time << " seconds z :: " << best_z << endl;
+    if (!quiet)
+        cout << "***  After " << setw(8) << setprecision(3) << best_time << " seconds z :: " << best_z << endl;
 #endif
     // save path of best solution
-    bestPath.clear();
-    bestPath.push_back(bay);
+    bestPath = path;
+    bestPath.push_back(mv);
+    bestPath.insert(bestPath.end(), heurPath.begin(), heurPath.end());
+}
 
-    for (int k = 0; k < path.size(); k++) 
-        bestPath.push_back(path[k]);
-    for (int k = 1; k < heurPath.size(); k++) 
-        bestPath.push_back(heurPath[k]);
+/// Keep the improvement of the incumbent just made (if \c tracing)
+/** The row is appended to \c trace, whose memory is reserved before the
+  run, so that tracing costs the search two clock readings and no I/O; the
+  rows are only written once the run is over (see write_trace()). To be
+  called with \c best_mutex held (or by the only thread of the run).
+
+  The cpu time is the one of cpu_time().
+  */
+void cm_run::trace_improvement()
+{
+    if (!tracing)
+        return;
+    trace_row row;
+    row.wall = tTime.elapsedTime(timer::REAL);
+    row.cpu  = cpu_time();
+    row.trajectory = (engine == ENGINE_CM) ? (long)n_trajectories : n_nodes;
+    row.z    = best_z;
+    trace.push_back(row);
 }
 
 /// Define the size of the corridor using a greedy scheme
 /** The element that must be relocated is found in
-  \c state[row].back() and a "taylor-made" corridor for
+  \c state.top(row) and a "taylor-made" corridor for
   this element can be defined.
 
   In this version, the meaning of \f$ \delta \f$ changes, since
@@ -423,20 +1091,26 @@ void update_best(int z, std::vector< std::vector<int> > bay,
   \param row : stack in which the current target element is found
   \param delta : number of stacks in the corridor
   \param constantV : type of vertical corridor defined
+  \param ws : work space of the trajectory (its random stream is used by
+  the roulette)
 
-  \return lambda : height limit for each stack
-  \return is_in_corridor : true for each stack if stack is in current corridor
+  \return ws.lambda : height limit for each stack
+  \return ws.is_in_corridor : true for each stack if stack is in current corridor
   */
-void define_stochastic_corridor(std::vector< std::vector <int> > state, int row, int * lambda, int delta, int constantV, bool * is_in_corridor, int h)
+void cm_run::define_stochastic_corridor(const bay_t & state, int row, int delta, int constantV, int h, cm_scratch & ws)
 {
+    int * lambda          = ws.lambda;
+    bool * is_in_corridor = ws.is_in_corridor;
+
     // initialization
     for (int i = 0; i < m; i++)
         is_in_corridor[i] = false;
 
-    // full width corridor
+    // full width corridor (stacks that reached the max height cannot be
+    // used, as in the stochastic corridor below)
     if (delta == -1)
         for (int i = 0; i < m; i++)
-            is_in_corridor[i] = true;
+            is_in_corridor[i] = (state.size(i) < h);
     is_in_corridor[row] = false;
 
     if (constantV == 1)
@@ -448,9 +1122,9 @@ void define_stochastic_corridor(std::vector< std::vector <int> > state, int row,
 
     // (i) define horizontal corridor
     // a. compute stack scores
-    int el = state[row].back();	// element to be relocated
-    double * score_stack = new double[m];
-    int * min_in_stack   = new int[m];
+    int el = state.top(row);	// element to be relocated
+    double * score_stack = ws.score_stack;
+    int * min_in_stack   = ws.min_in_stack;
     score_stack[row] = _ZERO;
     int tot_mins1 = 0;
     int tot_mins2 = 0;
@@ -463,9 +1137,9 @@ void define_stochastic_corridor(std::vector< std::vector <int> > state, int row,
         // at a certain point in time). Thus, the maximum height was respected
         // by the heuristic, but not in this phase. See Excel file with
         // corrected results.
-        if (state[i].size() >= h) continue;
-        // find minumum block in the stack
-        min_in_stack[i] = min_el_i(state, i);
+        if (state.size(i) >= h) continue;
+        // minimum block in the stack (kept up to date by the bay itself)
+        min_in_stack[i] = state.min_el(i);
         if (min_in_stack[i] == _MAXRANDOM)
             n_empty_stacks++;	// case I : empty stack
         else
@@ -480,7 +1154,7 @@ void define_stochastic_corridor(std::vector< std::vector <int> > state, int row,
     int nAvailable = m;
     for (int i = 0; i < m; i++)
     {
-        if (state[i].size() >= h || i == row)
+        if (state.size(i) >= h || i == row)
         {
             score_stack[i] = _ZERO;
             nAvailable--;
@@ -535,13 +1209,12 @@ void define_stochastic_corridor(std::vector< std::vector <int> > state, int row,
     // while (n_selected < delta)
     {
         // scores must always be normalized to 1
-        int rI = rand();
-        double r = (double)rI/(double)_MAXRANDOM;
+        double r = ws.rng.uniform();
         int k = 0;
-        while (is_in_corridor[k] == true || k == row && k < m)
+        while (is_in_corridor[k] == true || (k == row && k < m))
             k++;
         double cum = score_stack[k];
-        while (cum < r && k < m || k == row || state[k].size() >= h)
+        while ((cum < r && k < m) || k == row || state.size(k) >= h)
         {
             k++;
             if (is_in_corridor[k] == false)
@@ -577,7 +1250,7 @@ void define_stochastic_corridor(std::vector< std::vector <int> > state, int row,
   The stack \c target is added to the corridor and, consequently, the scores
   of the remaning stacks must be normalized to add up to \f$ 1\f$.
   */
-void normalize_scores(bool * is_in_corridor, int target, double * score_stack)
+void cm_run::normalize_scores(bool * is_in_corridor, int target, double * score_stack)
 {
     for (int i = 0; i < m; i++)
     {
@@ -587,6 +1260,93 @@ void normalize_scores(bool * is_in_corridor, int target, double * score_stack)
     }
 }
 
+/// Data shared by the workers evaluating a neighborhood in parallel
+struct nb_job
+{
+    cm_run * run;
+    const bay_t * state;	//!< Current bay (read only during the evaluation)
+    int row;			//!< Stack of the block to be relocated
+    int h;			//!< Max height of a stack
+    int l;			//!< Block to be retrieved
+    cm_scratch * ws;
+    std::atomic<int> z_heur;	//!< Best look-ahead value found so far in the neighborhood
+};
+
+/// Evaluate candidate \c task of a neighborhood on the bay of \c worker
+/** The worker bay is brought up to date with a single block copy of the
+  current bay (the first task a worker takes in a neighborhood), after
+  which the candidate is applied, evaluated and undone on that copy.
+
+  The rollout is cut off once it exceeds the best value found so far by
+  the other workers (see neighborhood_search()). Since the candidates are
+  not evaluated in stack order, a candidate tying with the best value must
+  still be evaluated to the end (cutoff \c z_heur + 1), so that the tie is
+  broken as in the sequential search.
+  */
+void evaluate_candidate(int task, int worker, void * arg)
+{
+    nb_job * job   = (nb_job *)arg;
+    cm_scratch & ws = *job->ws;
+    bay_t & node   = ws.replica[worker];
+    int i          = ws.cand[task];
+
+    if (ws.synced[worker] != ws.version)
+    {
+        node = *job->state;
+        ws.synced[worker] = ws.version;
+    }
+    node.move(job->row, i);
+    int z_heur = job->z_heur;
+    int cutoff = (z_heur < _MAXRANDOM) ? z_heur + 1 : _MAXRANDOM;
+    int value  = job->run->look_ahead(node, job->h, job->l, *ws.heur_w[worker], cutoff,
+        ws.tt_probes[worker], ws.tt_hits[worker]);
+    node.move(i, job->row);
+    ws.value[task] = value;
+    while (value < z_heur && !job->z_heur.compare_exchange_weak(z_heur, value))
+        ;
+}
+
+/// Horizon of the rollouts with block \c l to be retrieved next (0 : whole rollouts)
+/** On a large bay, a rollout to the last block costs as much as the rest
+  of the trajectory, for every candidate of every neighborhood. With a
+  horizon of K blocks, a rollout retrieves the next K blocks only and
+  estimates the rest (see block_heuristic()), so that many more
+  trajectories are built in the same time. Once no more than
+  \c horizon_full blocks are left, the rollouts are whole again: their
+  values are exact, as needed to update the incumbent (see
+  neighborhood_search()).
+  */
+int cm_run::horizon_at(int l) const
+{
+    int left = nels - l;
+    return (horizon > 0 && left > horizon && left > horizon_full) ? horizon : 0;
+}
+
+/// Look-ahead value of \c node, with block \c l to be retrieved next (see block_heuristic())
+/** The value is taken from the transposition table of the run if the
+  bay has already been evaluated. Otherwise the rollout is played and its
+  value stored, unless it has been cut off (the value is then only a
+  bound). The look-ups and hits are counted in \c probes and \c hits.
+  */
+int cm_run::look_ahead(bay_t & node, int h, int l, heur_scratch & hs, int cutoff, long & probes, long & hits)
+{
+    if (!tt.enabled())
+        return block_heuristic(node, m, h, nels, l, hs, NULL, cutoff, horizon_at(l));
+
+    uint64_t key = ttable::key(node, l);
+    int value;
+    probes++;
+    if (tt.probe(key, value))
+    {
+        hits++;
+        return value;
+    }
+    value = block_heuristic(node, m, h, nels, l, hs, NULL, cutoff, horizon_at(l));
+    if (value < cutoff)
+        tt.store(key, value);
+    return value;
+}
+
 /// Exaustive enumeration of all solutions in the current corridor/neighborhood
 /** Given the current element to be relocated and the corresponding corridor,
   we evaluate all possible moves and identify the "best" move in the neighborhood.
@@ -594,47 +1354,84 @@ void normalize_scores(bool * is_in_corridor, int target, double * score_stack)
   The quality of a move is determined via a greedy score that computes the
   total number of moves required to complete the retrieval process given 
   a specific configuration (see block_heuristic() for more details.)
+
+  Each candidate move is applied to \c state, evaluated by the heuristic
+  (which leaves the bay unchanged) and then undone, so that evaluating a
+  candidate costs as much as the moves performed, without copying the bay.
+
+  If a pool of workers is available, the look-ahead values of the
+  candidates are computed in parallel (see evaluate_candidate()). The
+  values are then scanned by the calling thread in stack order, so that
+  the move selected and the updates of the best solution are the same as
+  in the sequential search.
+
+  Only the best candidate matters (ties being broken in stack order), so
+  the rollout of a candidate is cut off as soon as it reaches the best
+  value found so far in the neighborhood (see block_heuristic()); the value
+  of such a candidate is then only a lower bound, which is enough to rule
+  it out. The incumbent is updated at most once per neighborhood, with the
+  best candidate, whose rollout is always complete, unless the rollouts
+  are truncated (see horizon_at()): the values are then estimates, and
+  the best candidate is played to the end only for the first incumbent
+  of the run, and then once the truncated rollouts have retrieved as many
+  blocks as a whole rollout would, so that the incumbent keeps improving
+  along the trajectory at the cost of about one more rollout per
+  neighborhood.
+
+  \return stack the block is relocated onto, -1 if no candidate is
+  feasible (empty corridor, or infeasible rollouts, see block_heuristic())
   */
-int neighborhood_search(std::vector< std::vector <int> > state, int row, int h, int l, int z_cum)
+int cm_run::neighborhood_search(bay_t & state, int row, int h, int l, int z_cum, cm_scratch & ws)
 {
-    std::vector< std::vector <int> > aux;	   //!< Node
-    std::vector< std::vector <int> >::iterator it;
-    std::vector< int > stack_aux;
-    std::vector< int >::iterator stack_it;
-
 #ifdef W_GRASP
     std::vector< int > scores;
     int tot_score = 0;
 #endif
 
-    lambda = new int[m];
-    bool * is_in_corridor = new bool[m];
-    define_stochastic_corridor(state, row, lambda, delta, constantV, is_in_corridor, h);
+    STATS(tick_t t0 = tick());
+    bool * is_in_corridor = ws.is_in_corridor;
+    define_stochastic_corridor(state, row, delta, constantV, h, ws);
 
-    // evaluate each possible move in the neighborhood
-    int z_heur = _MAXRANDOM;
-    int target = -1;
+    // collect the candidate stacks
+    int n_cand = 0;
     for (int i = 0; i < m; i++)
-    {
-        if (!is_in_corridor[i]) continue;
+        if (is_in_corridor[i])
+            ws.cand[n_cand++] = i;
+    STATS(tick_t t1 = tick());
+    STATS(ws.stats.corridor(n_cand));
 
-        // copy state into auxiliary structure      
-        aux.clear();
-        for (it = state.begin(); it != state.end(); it++)
+    // look-ahead value of each candidate move
+    if (ws.pool != NULL && n_cand > 1)
+    {
+        nb_job job = { this, &state, row, h, l, &ws, (int)_MAXRANDOM };
+        ws.version++;
+        ws.pool->run(n_cand, evaluate_candidate, &job);
+    }
+    else
+    {
+        int cutoff = _MAXRANDOM;	// best value so far
+        for (int c = 0; c < n_cand; c++)
         {
-            for (stack_it = (*it).begin(); stack_it != (*it).end(); stack_it++)
-                stack_aux.push_back(*stack_it);
-            aux.push_back(stack_aux);
-            stack_aux.clear();
-
+            // apply candidate move, complete the solution using the
+            // heuristic (the path is not recorded here, see below) and undo
+            state.move(row, ws.cand[c]);
+            ws.value[c] = look_ahead(state, h, l, ws.heur, cutoff, ws.tt_probes[0], ws.tt_hits[0]);
+            state.move(ws.cand[c], row);
+            if (ws.value[c] < cutoff)
+                cutoff = ws.value[c];
         }
+    }
+    STATS(tick_t t2 = tick());
+    STATS(ws.stats.t_corridor += seconds(t0, t1));
+    STATS(ws.stats.t_rollout  += seconds(t1, t2));
 
-        aux[i].push_back(aux[row].back());
-        aux[row].pop_back();
-
-        // now complete the solution using the heuristic
-        std::vector < std::vector< std::vector<int> > > heurPath;
-        int heur_value = block_heuristic(aux, m, h, nels, l, heurPath);
+    // select the best move in the neighborhood
+    int z_heur = _MAXRANDOM;
+    int target = -1;
+    for (int c = 0; c < n_cand; c++)
+    {
+        int i          = ws.cand[c];
+        int heur_value = ws.value[c];
         // cout << "heur value is " << heur_value << endl;
 
 #ifdef W_GRASP
@@ -647,9 +1444,26 @@ int neighborhood_search(std::vector< std::vector <int> > state, int row, int h,
             z_heur = heur_value;
             target = i;
         }
-        // count also the current relocation (+1)
-        if ((heur_value + z_cum + 1) < best_z)
-            update_best(heur_value + z_cum + 1, bay, path, heurPath);
+    }
+    // count also the current relocation (+1)
+    bool whole = (horizon_at(l) == 0 || best_z == _MAXRANDOM);
+    if (!whole)
+    {
+        ws.truncated += horizon;
+        whole = (ws.truncated >= nels - l);
+    }
+    if (target != -1 && (z_heur + z_cum + 1) < best_z && whole)
+    {
+        ws.truncated = 0;
+        // the heuristic is deterministic: play it again (to the end), this
+        // time recording the path leading to the new best solution
+        std::vector < move_t > heurPath;
+        state.move(row, target);
+        z_heur = block_heuristic(state, m, h, nels, l, ws.heur, &heurPath, _MAXRANDOM);
+        state.move(target, row);
+        move_t mv = { row, target };
+        if (z_heur < _MAXRANDOM)	// a truncated rollout may hide an infeasible one
+            update_best(z_heur + z_cum + 1, ws.path, mv, heurPath);
     }
 
     return target;
@@ -659,13 +1473,61 @@ int neighborhood_search(std::vector< std::vector <int> > state, int row, int h,
 /** Given the current bay and the retrieval order, define a path that leads to
   the final configuration (all blocks are retrieved) minimizing the total
   number of relocations.
+
+  The trajectory is played directly on \c state (no copy of the bay is
+  made): once the trajectory is over, its moves are undone and \c state
+  is back to the initial configuration.
+  */
+void cm_run::search_trajectory(bay_t & state, cm_scratch & ws)
+{
+    ws.path.clear();
+    build_trajectory(state, ws);
+    state.rollback(ws.path, 1);
+}
+
+/// Build trajectories until the stopping criterion is met
+/** Each worker owns a copy of the initial bay and a work space; the only
+  state shared with the other workers is the incumbent solution (see
+  update_best()). The random stream of worker \c k is stream \c k of the
+  seed of the run, hence the trajectories built by each worker only depend
+  on the seed (and on the incumbent, through fathoming).
   */
-void search_trajectory()
+void cm_run::trajectory_worker(int worker)
+{
+    STATS(tick_t t0 = tick());
+    cm_scratch & ws = *scratch[worker];
+    bay_t & state   = ws.state;
+    state = bay;
+    ws.reset();
+    ws.rng.set_seed(seed, worker);
+
+    while (start_trajectory())
+    {
+        search_trajectory(state, ws); 
+        // print_bay(state);
+    }
+    for (unsigned w = 0; w < ws.tt_probes.size(); w++)
+    {
+        tt_probes += ws.tt_probes[w];
+        tt_hits   += ws.tt_hits[w];
+    }
+#ifdef W_STATS
+    ws.stats.t_total = seconds(t0, tick());
+    ws.stats.rollouts       += ws.heur.n_rollouts;
+    ws.stats.rollout_relocs += ws.heur.n_relocs;
+    for (unsigned w = 0; w < ws.heur_w.size(); w++)
+    {
+        ws.stats.rollouts       += ws.heur_w[w]->n_rollouts;
+        ws.stats.rollout_relocs += ws.heur_w[w]->n_relocs;
+    }
+    std::lock_guard<std::mutex> lock(best_mutex);
+    stats.add(ws.stats);
+#endif
+}
+
+/// Move from the initial bay toward the final configuration (see search_trajectory())
+void cm_run::build_trajectory(bay_t & state, cm_scratch & ws)
 {
-    std::vector< std::vector <int> > state;
-    std::vector< std::vector <int> >::iterator it;
-    std::vector< int > stack_aux;
-    std::vector< int >::iterator stack_it;
     int row, col, n_rel;
     int h;
     bool no_relocations = true;
@@ -673,24 +1535,17 @@ void search_trajectory()
     if (constantV == 1)
         h = n;
     else
-        h = bay[0].size() + n;
+        h = state.size(0) + n;
 
 
     int z_cum = 0;
-    // copy bay into auxiliary structure      
-    for (it = bay.begin(); it != bay.end(); it++)
-    {
-        for (stack_it = (*it).begin(); stack_it != (*it).end(); stack_it++)
-            stack_aux.push_back(*stack_it);
-        state.push_back(stack_aux);
-        stack_aux.clear();
-    }
     // retrieve one block at a time
     for (int l = 1; l < nels-1; l++)
     {
         // cout << "RETRIEVING block " << l << endl;
         // print_bay(state);
-        if (stopping_criterion()) break;
+        // an interrupted trajectory must not be taken as a solution
+        if (stopping_criterion()) return;
 
         // find position of block to be retrieved
         if (!found_element(l, state, row, col))
@@ -699,16 +1554,17 @@ void search_trajectory()
             print_bay(state);
             exit(-1);
         }
-        assert(state[row][col] == l);
+        assert(state.at(row, col) == l);
 #ifdef M_DEBUG
         cout << "El " << l << " found in " << row << ", " << col << endl;
 #endif
         // compute number of blocks to be relocated
-        n_rel       = state[row].size() - col - 1;
+        n_rel       = state.size(row) - col - 1;
         if (n_rel == 0)
         {  // no alternatives (the target block is already on top of the stack)
-            state[row].pop_back();
-            path.push_back(state);
+            state.pop(row);
+            move_t mv = { row, -1 };
+            ws.path.push_back(mv);
             continue;
         }
 
@@ -718,28 +1574,36 @@ void search_trajectory()
             no_relocations = false;
             // explore neighborhood
             //int target_stack = neighborhood_search_grasp(state, row, h, l, z_cum);
-            int target_stack = neighborhood_search(state, row, h, l, z_cum);
+            int target_stack = neighborhood_search(state, row, h, l, z_cum, ws);
+            // no feasible relocation (every candidate stack is at the
+            // height limit, or leads to an infeasible rollout)
+            if (target_stack == -1)
+                return;
             //  relocate block (move)
             z_cum++;		// count current move
             // check if trajectory can be fathomed
             if (z_cum >= best_z)
             {
-                // empty structure holding current path
-                path.clear();
+                STATS(ws.stats.fathomed++);
                 return;
             }
 
-            state[target_stack].push_back(state[row].back());
-            state[row].pop_back();
+            state.move(row, target_stack);
+            move_t mv = { row, target_stack };
+            ws.path.push_back(mv);
         }
         // now remove element
-        state[row].pop_back();
-        path.push_back(state);
+        state.pop(row);
+        move_t mv = { row, -1 };
+        ws.path.push_back(mv);
     }
     if (no_relocations && best_z > 0)
     {
+        std::lock_guard<std::mutex> lock(best_mutex);
         best_z = 0;
         best_time = -999;
+        bestPath = ws.path;
+        trace_improvement();
     }
 }
 
@@ -783,3 +1647,254 @@ void weight_assignment(double & w1, double & w2, double & w3, double tot_mins1,
 
 }
 
+/// Instance of a batch (read once and shared by all the jobs on it)
+struct batch_instance
+{
+    brp_instance bay;		//!< Instance file and initial bay
+    int H;			//!< Initial height of the tallest stack
+};
+
+/// Job of a batch: one run of the algorithm on an instance
+struct batch_job
+{
+    int inst;			//!< Instance (index in batch_data::inst)
+    int delta;			//!< Corridor width
+    int n;			//!< Max height of each stack
+    double time_limit;		//!< Wall-clock deadline (seconds, 0 : none)
+    int rep;			//!< Replication number
+};
+
+/// Data shared by the workers of a batch
+struct batch_data
+{
+    std::vector < batch_instance > inst;
+    std::vector < batch_job > jobs;
+    brp_options opt;		//!< Parameters of the batch (defaults of each job)
+    ofstream out;		//!< One result row per job
+    ofstream stats;		//!< Counters of each job (W_STATS only, see stats.h)
+    ofstream trace;		//!< Improvements of each job (if -a is given)
+    std::mutex out_mutex;	//!< Guards \c out and the progress report
+    int n_done;			//!< Number of jobs completed
+};
+
+/// Parse a list of corridor widths, e.g., "1:4,8" or "all" (1 to \c m)
+bool parse_widths(const std::string & list, int m, std::vector < int > & widths)
+{
+    std::stringstream ss(list);
+    std::string item;
+    while (getline(ss, item, ','))
+    {
+        int a, b;
+        if (item == "all")
+        {
+            a = 1;
+            b = m;
+        }
+        else if (item.find(':') != std::string::npos)
+        {
+            if (sscanf(item.c_str(), "%d:%d", &a, &b) != 2)
+                return false;
+        }
+        else if (sscanf(item.c_str(), "%d", &a) == 1)
+            b = a;
+        else
+            return false;
+        for (int d = a; d <= b; d++)
+            widths.push_back(d);
+    }
+    return !widths.empty();
+}
+
+/// Solve job \c task of the batch \c arg and append its result row
+void run_job(int task, int /* worker */, void * arg)
+{
+    batch_data & data        = *(batch_data *)arg;
+    const batch_job & job    = data.jobs[task];
+    const batch_instance & I = data.inst[job.inst];
+
+    brp_options opt = data.opt;
+    opt.quiet       = true;
+    opt.delta       = job.delta;
+    opt.n           = job.n;
+    opt.stop.wall   = job.time_limit;
+    opt.seed        = data.opt.seed + task;
+    opt.tracing     = data.trace.is_open();
+    brp_solver solver(opt);
+    brp_result res  = solver.solve(I.bay);
+
+    std::lock_guard<std::mutex> lock(data.out_mutex);
+    write_result(data.out, opt, res);
+    data.out.flush();
+    if (opt.tracing)
+    {
+        write_trace(data.trace, opt, res);
+        data.trace.flush();
+    }
+#ifdef W_STATS
+    data.stats << ((data.n_done > 0) ? ",\n" : "") << "  ";
+    write_stats(data.stats, opt, res);
+    data.stats.flush();
+#endif
+    data.n_done++;
+#ifdef W_OUT
+    cout << "[" << setw(6) << data.n_done << "/" << data.jobs.size() << "] " 
+        << I.bay.name << " d = " << job.delta << " rep = " << job.rep 
+        << " z :: " << res.z << endl;
+#endif
+}
+
+/// Batch mode: solve all the jobs of a manifest within this process
+/** Each line of the manifest (file given with -b) defines the jobs on a
+  set of instances:
+  \verbatim
+  <file or glob pattern> [d=<widths>] [n=<height>] [t=<time>] [r=<replications>]
+  \endverbatim
+  where \c widths is a comma separated list of corridor widths or ranges
+  (e.g., "1:4,8", or "all" for 1 to \c m), \c height is either an absolute
+  max height or "+k", i.e., \c k tiers above the tallest initial stack
+  (default: the -n option if given, "+2" otherwise), \c time is in
+  seconds, as with -t, and the remaining values default to the command
+  line options. Empty lines and lines
+  starting with '#' are skipped. The pattern may also select the members
+  of a tar archive, e.g., data.tar:data/data3-*.dat (see instance.cpp), in
+  which case the archive is mapped and indexed once for the whole batch.
+
+  Every instance is read once. The jobs (instance x width x replication)
+  are handed out to -j concurrent workers (see task_pool), each job being
+  an independent run (see cm_run), and one result row per job, in the
+  format of result.dat, is appended to the output file (-o) as soon as
+  the job is over. Job \c k (in the order of the manifest) is run with
+  seed \c s + \c k, where \c s is the seed of the batch (-s).
+  */
+int run_batch(const brp_options & opt)
+{
+    batch_data data;
+    data.n_done = 0;
+    data.opt    = opt;
+
+    ifstream fman(_BATCHFILE, ios::in);
+    if (!fman)
+    {
+        cerr << "Cannot open file " << _BATCHFILE << endl;
+        return 1;
+    }
+    std::string line;
+    while (getline(fman, line))
+    {
+        std::stringstream ss(line);
+        std::string pattern, item;
+        if (!(ss >> pattern) || pattern[0] == '#')
+            continue;
+
+        std::string widths = "";
+        std::string height = "";
+        double t_lim = opt.stop.wall;
+        int n_rep = 1;
+        while (ss >> item)
+        {
+            if (item.compare(0, 2, "d=") == 0)
+                widths = item.substr(2);
+            else if (item.compare(0, 2, "n=") == 0)
+                height = item.substr(2);
+            else if (item.compare(0, 2, "t=") == 0)
+            {
+                if (!parse_budget(item.c_str() + 2, t_lim))
+                {
+                    cerr << "Wrong time limit " << item << " in " << _BATCHFILE << endl;
+                    return 1;
+                }
+            }
+            else if (item.compare(0, 2, "r=") == 0)
+                n_rep = atoi(item.c_str() + 2);
+            else
+            {
+                cerr << "Unknown field " << item << " in " << _BATCHFILE << endl;
+                return 1;
+            }
+        }
+
+        std::vector < std::string > files;
+        if (!expand_instances(pattern.c_str(), files))
+        {
+            cerr << "No instance matches " << pattern << endl;
+            continue;
+        }
+        for (size_t f = 0; f < files.size(); f++)
+        {
+            batch_instance I;
+            if (!I.bay.read(files[f].c_str()))
+            {
+                cerr << "Cannot read instance " << files[f] << endl;
+                continue;
+            }
+            const std::vector< std::vector<int> > & stacks = I.bay.stacks;
+            I.H = 0;
+            for (unsigned i = 0; i < stacks.size(); i++)
+                if ((int)stacks[i].size() > I.H)
+                    I.H = stacks[i].size();
+
+            std::vector < int > d_list;
+            if (widths.empty())
+                d_list.push_back(opt.delta);
+            else if (!parse_widths(widths, stacks.size(), d_list))
+            {
+                cerr << "Wrong corridor widths " << widths << endl;
+                return 1;
+            }
+            batch_job job;
+            job.inst       = data.inst.size();
+            job.time_limit = t_lim;
+            if (height.empty())
+                job.n = (opt.n > 0) ? opt.n : I.H + 2;
+            else if (height[0] == '+')
+                job.n = I.H + atoi(height.c_str() + 1);
+            else
+                job.n = atoi(height.c_str());
+            for (unsigned d = 0; d < d_list.size(); d++)
+                for (int r = 1; r <= n_rep; r++)
+                {
+                    job.delta = d_list[d];
+                    job.rep   = r;
+                    data.jobs.push_back(job);
+                }
+            data.inst.push_back(I);
+        }
+    }
+    fman.close();
+
+    data.out.open(_OUTFILE, ios::out);
+    if (!data.out)
+    {
+        cerr << "Cannot open file " << _OUTFILE << endl;
+        return 1;
+    }
+    if (_TRACEFILE != NULL)
+    {
+        data.trace.open(_TRACEFILE, ios::out);
+        if (!data.trace)
+            cerr << "Cannot open file " << _TRACEFILE << endl;
+    }
+#ifdef W_STATS
+    std::string fname = stats_file(_OUTFILE);
+    data.stats.open(fname.c_str(), ios::out);
+    if (!data.stats)
+        cerr << "Cannot open file " << fname << endl;
+    data.stats << "[" << endl;
+#endif
+#ifdef W_OUT
+    cout << "Batch " << _BATCHFILE << " :: " << data.jobs.size() << " jobs on " 
+        << data.inst.size() << " instances (" << n_jobs << " concurrent jobs)" << endl;
+#endif
+
+    task_pool pool(n_jobs);
+    pool.run(data.jobs.size(), run_job, &data);
+    data.out.close();
+    data.trace.close();
+#ifdef W_STATS
+    data.stats << endl << "]" << endl;
+    data.stats.close();
+#endif
+
+    cout << "CM : Batch completed, " << data.n_done << " results written to " << _OUTFILE << endl;
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*! \file containers.h
+  \brief Corridor method: work space of a trajectory and run of the algorithm
+*/
+#ifndef containers_H
+#define containers_H
+#include <ostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "timer.h"
+#include "rng.h"
+#include "bay.h"
+#include "heuristic.h"
+#include "ttable.h"
+#include "pool.h"
+#include "stats.h"
+#include "stop.h"
+#include "options.h"
+
+/// Work space of a trajectory
+/** All the buffers needed to define a corridor and to evaluate the
+  moves in the neighborhood are allocated once and reused for every
+  relocation, so that no memory is allocated in the inner loop. When the
+  neighborhood is evaluated in parallel, each worker of \c pool has its own
+  copy of the current bay and its own heuristic work space.
+
+  Each trajectory worker (see trajectory_worker()) owns one work space,
+  which also holds the bay and the path of its current trajectory. The
+  work spaces are kept by the run, and reused when it is solved again (see
+  cm_run::prepare()).
+  */
+struct cm_scratch
+{
+    bay_t state;		//!< Bay of the current trajectory
+    std::vector < move_t > path; //!< Moves of the current trajectory
+    task_pool * pool;		//!< Workers of the neighborhood search (NULL : sequential)
+    int    * lambda;		//!< Height limit of each stack
+    bool   * is_in_corridor;	//!< True if the stack is in the current corridor
+    double * score_stack;	//!< Score of each stack (corridor selection)
+    int    * min_in_stack;	//!< Min block of each stack (corridor selection)
+    int    * cand;		//!< Candidate stacks of the neighborhood
+    int    * value;		//!< Look-ahead value of each candidate
+    heur_scratch heur;		//!< Work space of the look-ahead heuristic
+    std::vector < bay_t > replica;	//!< Copy of the bay of each worker
+    std::vector < heur_scratch * > heur_w; //!< Heuristic work space of each worker
+    long version;		//!< Number of parallel neighborhoods evaluated so far
+    std::vector < long > synced;	//!< Last neighborhood copied into each replica
+    rng_t rng;			//!< Random stream of the trajectory worker (corridor selection)
+    std::vector < long > tt_probes;	//!< Transposition table look-ups of each worker
+    std::vector < long > tt_hits;	//!< Transposition table hits of each worker
+    run_stats stats;		//!< Counters of the trajectory worker (see stats.h)
+    long truncated;		//!< Blocks of truncated rollouts since the last whole one (see neighborhood_search())
+    int m_max;			//!< Number of stacks the buffers are sized for
+
+    cm_scratch(int m, int n_threads) : pool(NULL), lambda(new int[m]), is_in_corridor(new bool[m]),
+        score_stack(new double[m]), min_in_stack(new int[m]), cand(new int[m]),
+        value(new int[m]), heur(m), version(0),
+        tt_probes(n_threads > 1 ? n_threads : 1, 0), tt_hits(n_threads > 1 ? n_threads : 1, 0), truncated(0), m_max(m)
+    {
+        if (n_threads > 1)
+        {
+            pool = new task_pool(n_threads);
+            replica.resize(n_threads);
+            synced.resize(n_threads, -1);
+            for (int w = 0; w < n_threads; w++)
+                heur_w.push_back(new heur_scratch(m));
+        }
+    }
+    ~cm_scratch()
+    {
+        delete pool;
+        delete [] lambda;
+        delete [] is_in_corridor;
+        delete [] score_stack;
+        delete [] min_in_stack;
+        delete [] cand;
+        delete [] value;
+        for (unsigned w = 0; w < heur_w.size(); w++)
+            delete heur_w[w];
+    }
+    /// Clear the counters (start of a run)
+    void reset()
+    {
+        std::fill(tt_probes.begin(), tt_probes.end(), 0);
+        std::fill(tt_hits.begin(), tt_hits.end(), 0);
+        stats.clear();
+        truncated = 0;
+        heur.n_rollouts = heur.n_relocs = 0;
+        for (unsigned w = 0; w < heur_w.size(); w++)
+            heur_w[w]->n_rollouts = heur_w[w]->n_relocs = 0;
+    }
+private:
+    cm_scratch(const cm_scratch &);
+    cm_scratch & operator=(const cm_scratch &);
+};
+
+/// A run of the algorithm on one instance
+/** The instance, the parameters of the algorithm and the incumbent
+  solution of a run are kept together, rather than in global variables,
+  so that several runs (e.g., the jobs of a batch, see run_batch()) can be
+  solved concurrently within the same process. Programs embedding the
+  solver go through brp_solver (see solver.h), which sets up a run for
+  each bay to be solved.
+  */
+class cm_run
+{
+public:
+    const char * name;		//!< Instance name
+    bay_t bay;			//!< Initial configuration of the bay
+    std::vector < move_t > bestPath;	//!< Moves of the best solution found
+    std::vector < block_move_t > start;	//!< Previous solution to start from, by block (see warm_start())
+    int start_z;		//!< Relocations of the repaired start (-1 : no warm start)
+    int m;			//!< Number of Stacks
+    int n;			//!< Max height of each Stack
+    int delta;			//!< Max horizontal width corridor
+    int nels;			//!< Total number of blocks in the bay
+    int lb;			//!< Lower bound on the number of relocations (see bound.cpp)
+    int constantV;		//!< Vertical corridor type (1 : constant; 0 : variable)
+    int n_threads;		//!< Number of threads for the neighborhood search
+    int n_workers;		//!< Number of trajectories built concurrently
+    stop_policy stop;		//!< When to stop the run (see stop.h)
+    long seed;			//!< Seed of the run (worker k uses stream k, see rng.h)
+    int tt_bits;		//!< log2 of the transposition table size (0 : no table)
+    int engine;			//!< Search engine (ENGINE_CM, ENGINE_IDA or ENGINE_BEAM)
+    int beam_width;		//!< Number of states kept by the beam engine
+    int horizon;		//!< Blocks retrieved by a rollout before the rest is estimated (0 : whole rollouts)
+    int horizon_full;		//!< Remaining blocks from which rollouts are whole again
+    bool quiet;			//!< Do not print the parameters and the improvements on screen
+    std::atomic<int> best_z;	//!< Objective function value of best solution
+    double best_time;		//!< Time to best solution
+    std::mutex best_mutex;	//!< Guards the update of best_z, best_time and bestPath
+    std::atomic<long> n_trajectories; //!< Number of trajectories started
+    std::atomic<long> last_improvement; //!< Trajectories started at the last improvement
+    std::atomic<int> stop_reason;	//!< Policy that stopped the run (STOP_NONE : none yet)
+    tick_t t_start;		//!< Start of the run (monotonic clock)
+    ttable tt;			//!< Look-ahead values of the bays evaluated (shared by all threads)
+    std::atomic<long> tt_probes;	//!< Transposition table look-ups
+    std::atomic<long> tt_hits;	//!< Transposition table hits
+    long n_nodes;		//!< Nodes explored by the exact engine (states expanded by the beam)
+    run_stats stats;		//!< Counters of the run (see stats.h)
+    double run_time;		//!< Wall-clock seconds spent by solve() (see wall_time())
+    bool tracing;		//!< Keep the improvements of the incumbent in \c trace
+    std::vector < trace_row > trace;	//!< Improvements of the incumbent (if \c tracing)
+    std::vector < cm_scratch * > scratch;	//!< Work space of each trajectory worker
+    task_pool * workers;	//!< Trajectory workers (NULL : the calling thread only)
+    timer tTime;		//!< Ojbect clock to measure REAL and VIRTUAL (cpu) time
+
+    explicit cm_run(const brp_options & opt = brp_options());
+    ~cm_run();
+
+    void configure(const brp_options & opt);
+    void prepare();
+
+    void set_bay(const std::vector< std::vector<int> > & stacks, int nels_);
+    void solve();
+    void solve_exact();
+    void solve_beam();
+    void warm_start();
+    void trace_improvement();
+    void printing_parameters();	
+    int stopping_criterion();	
+    bool optimal() const { return best_z <= lb; }
+    double elapsed_time();
+    double wall_time() { return seconds(t_start, tick()); }
+    double cpu_time();
+    bool start_trajectory();
+    void print_bay(const bay_t & bay);
+    void print_path(const bay_t & bay, const std::vector < move_t > & moves);
+    void update_best(int z, const std::vector < move_t > & path, const move_t & mv, const std::vector < move_t > & heurPath);
+    void define_stochastic_corridor(const bay_t & state, int row, int delta, int constantV, int h, cm_scratch & ws);
+    void normalize_scores(bool * is_in_corridor, int target, double * score_stack);
+    int  horizon_at(int l) const;
+    int  look_ahead(bay_t & node, int h, int l, heur_scratch & hs, int cutoff, long & probes, long & hits);
+    int  neighborhood_search(bay_t & state, int row, int h, int l, int z_cum, cm_scratch & ws);
+    void trajectory_worker(int worker);
+    void search_trajectory(bay_t & state, cm_scratch & ws);
+    void build_trajectory(bay_t & state, cm_scratch & ws);
+private:
+    cm_run(const cm_run &);
+    cm_run & operator=(const cm_run &);
+};
+#endif
@@ -0,0 +1,190 @@
+/*! \file exact.cpp
+  \brief Exact IDA* engine for the restricted Block Relocation Problem
+
+  The optimal number of relocations of a bay is found by depth-first
+  iterative deepening (IDA*): a search tree is explored depth-first with
+  a limit on the number of relocations, which is raised by one until a
+  solution within the limit is found, or until the limit reaches the
+  value of the initial solution (given by block_heuristic()), which is
+  then optimal. A node is pruned as soon as the relocations performed plus a
+  lower bound on the remaining ones (see bound.cpp) exceed the limit.
+
+  As in the corridor method, the problem is the restricted one: only the
+  block on top of the block to be retrieved is relocated, onto a stack
+  below the height limit \c h. Blocks are retrieved as soon as they are
+  on top of their stack. Since all the stacks have the same height limit,
+  only the first empty stack is tried.
+
+  The search is played on a single bay (each move is applied and then
+  undone), so that the memory used only depends on the size of the bay
+  and on the depth of the tree, and no memory is allocated once the
+  search has started.
+*/
+#include "bay.h"
+#include "bound.h"
+#include "exact.h"
+
+namespace {
+
+/// State of an IDA* search
+struct ida_state
+{
+    bay_t node;			//!< Current bay
+    bay_t lb_node;		//!< Work space of lb_lookahead()
+    int h;			//!< Max height of a stack
+    int k;			//!< Next block to be retrieved
+    int limit;			//!< Max number of relocations of the current iteration
+    std::vector < move_t > path;	//!< Moves from the initial bay to the current one
+    std::vector < int > order;	//!< Candidate stacks at each depth (m per depth)
+    long n_nodes;		//!< Nodes explored
+    bool aborted;		//!< The stopping test has been met
+    stop_t stop;
+    void * arg;
+
+    bool dfs(int g);
+    int  candidates(int row, int el, int * cand) const;
+};
+
+/// Stacks the block \c el on top of stack \c row can be relocated to, best first
+/** Stacks whose minimum is larger than \c el (no new blocking block) come
+  first, the tightest one first; the other stacks follow, the largest
+  minimum first. Full stacks, and every empty stack but the first one,
+  are skipped.
+
+  \return number of candidate stacks written in \c cand
+  */
+int ida_state::candidates(int row, int el, int * cand) const
+{
+    int n_cand = 0;
+    bool empty_taken = false;
+    for (int i = 0; i < node.m; i++)
+    {
+        if (i == row || node.size(i) >= h)
+            continue;
+        if (node.size(i) == 0)
+        {
+            if (empty_taken)
+                continue;
+            empty_taken = true;
+        }
+        // insertion in order of preference
+        int key = node.min_el(i);
+        int c   = n_cand++;
+        for (; c > 0; c--)
+        {
+            int other = node.min_el(cand[c-1]);
+            bool before = (key > el) ? (other < el || key < other) : (other < el && key > other);
+            if (!before)
+                break;
+            cand[c] = cand[c-1];
+        }
+        cand[c] = i;
+    }
+    return n_cand;
+}
+
+/// Explore the subtree of the current bay, \c g relocations having been performed
+/** \return true if a solution with at most \c limit relocations is found
+  (\c path is then the complete solution)
+  */
+bool ida_state::dfs(int g)
+{
+    if ((++n_nodes & 4095) == 0 && stop(arg))
+        aborted = true;
+    if (aborted)
+        return false;
+
+    // retrieve the blocks that are already on top of their stack
+    int row, col;
+    int n_ret = 0;
+    bool in_bay;
+    while ((in_bay = (k < (int)node.pos.size() && node.locate(k, row, col))) && col == node.size(row) - 1)
+    {
+        node.pop(row);
+        move_t mv = { row, -1 };
+        path.push_back(mv);
+        k++;
+        n_ret++;
+    }
+
+    bool found = false;
+    if (!in_bay)
+        found = true;		// empty bay
+    else if (g + node.n_bad <= limit && g + lb_lookahead(node, lb_node) <= limit)
+    {
+        int el     = node.top(row);
+        int * cand = &order[g*node.m];
+        int n_cand = candidates(row, el, cand);
+        for (int c = 0; c < n_cand && !found; c++)
+        {
+            node.move(row, cand[c]);
+            move_t mv = { row, cand[c] };
+            path.push_back(mv);
+            found = dfs(g + 1);
+            if (!found)
+            {
+                path.pop_back();
+                node.move(cand[c], row);
+            }
+        }
+    }
+    if (found)
+        return true;
+
+    // put back the blocks retrieved above
+    for (; n_ret > 0; n_ret--)
+    {
+        node.push(path.back().from, --k);
+        path.pop_back();
+    }
+    return false;
+}
+
+}
+
+/// Optimal solution of the restricted BRP on \c bay, stacks limited to \c h blocks
+/** The solution in \c bestPath (e.g., the one of block_heuristic()), of
+  \c ub relocations, is the initial upper bound (INT_MAX if there is no
+  initial solution). The search is stopped
+  when \c stop(\c arg), polled every few thousand nodes, returns true:
+  the best solution known (the initial one, since IDA* only finds optimal
+  solutions) is then returned.
+
+  \param bestPath : moves of the initial solution, replaced by the optimal
+  one if it is found
+  \param lb : lower bound proven by the search (equal to the value returned
+  if the solution is optimal)
+  \param n_nodes : number of nodes explored
+
+  \return number of relocations of the solution returned
+  */
+int ida_search(const bay_t & bay, int h, int nels, int ub, std::vector < move_t > & bestPath,
+    int & lb, long & n_nodes, stop_t stop, void * arg)
+{
+    ida_state S;
+    S.node    = bay;
+    S.h       = h;
+    S.k       = 1;
+    S.n_nodes = 0;
+    S.aborted = false;
+    S.stop    = stop;
+    S.arg     = arg;
+
+    S.path.reserve(bestPath.size() + nels);
+    // no solution with less than S.limit relocations at each iteration
+    for (S.limit = lb_lookahead(bay, S.lb_node); S.limit < ub; S.limit++)
+    {
+        S.order.resize((S.limit + 1)*bay.m);
+        if (S.dfs(0))
+        {
+            ub = S.limit;
+            bestPath = S.path;
+            break;
+        }
+        if (S.aborted)
+            break;
+    }
+    lb      = (S.limit < ub) ? S.limit : ub;
+    n_nodes = S.n_nodes;
+    return ub;
+}
@@ -0,0 +1,11 @@
+#ifndef exact_H
+#define exact_H
+#include <vector>
+#include "bay.h"
+
+/// Stopping test polled by the exact engine (true : stop the search)
+typedef bool (*stop_t)(void * arg);
+
+int ida_search(const bay_t & bay, int h, int nels, int ub, std::vector < move_t > & bestPath,
+    int & lb, long & n_nodes, stop_t stop, void * arg);
+#endif
@@ -32,80 +32,26 @@
 #include <iomanip>
 #include <limits>
 #include <cstdlib>
+#include "bay.h"
+#include "heuristic.h"
 
 using namespace std;
 const long _MAXRANDOM   = numeric_limits<int>::max();       //!< Max Integer (2147483647)
 
-int counter;
-
-bool find_element(int l, std::vector < std::vector <int> > node, int & row, 
-int & col)
+/// Find stack \c row and tier \c col of block \c l (via the position index of the bay)
+bool find_element(int l, const bay_t & node, int & row, int & col)
 {
-    bool found = false;
-    row = -1;
-    col = -1;
-    for (int i = 0; i < node.size(); i++) 
-    {
-        for (int j = 0; j < node[i].size(); j++) 
-        {
-            if (node[i][j] == l)
-            {
-                found = true;
-                row = i;
-                col = j;
-                break;
-            }
-        }
-        if (found) break;
-        
-    }
-    return found; 
+    return node.locate(l, row, col);
 }
 
-/* bool find_element(int l, std::vector < std::vector <int> > node, int & row, int & col)
- * {
- *     bool found = false;
- *     row = 0;
- *     col = 0;
- *
- *     std::vector < std::vector <int> >::iterator sIt;
- *     std::vector <int>::iterator pcol;
- *     sIt = node.begin();
- *     cout << "Node here is " << *sIt << endl;
- *     while (!found &&  sIt != node.end())
- *     {
- *         pcol = (*sIt).begin();
- *         col  = 0;
- *         while (*pcol != l && pcol != (*sIt).end())
- *         {
- *             pcol++;
- *             col++;
- *         }
- *
- *         if (pcol != (*sIt).end())
- *             found = true;
- *         else
- *         {
- *             do
- *             {
- *                 row++;
- *                 sIt++;
- *             }while (node[row].size() == 0);
- *         }
- *     }
- *     return found;
- * } */
-
 /// Print bay on screen
-void print_node(std::vector< std::vector <int> > bay, int m)
+void print_node(const bay_t & bay, int m)
 {
-    std::vector < int>::iterator sIt;
-
     for (int i = 0; i < m; i++)
     {
         cout << "stack " << setw(3) << i << setw(2) << "|";
-        for (sIt = bay[i].begin(); sIt != bay[i].end(); sIt++)
-            cout << setw(4) << *sIt;
+        for (int j = 0; j < bay.size(i); j++)
+            cout << setw(4) << bay.at(i, j);
         cout << endl;
     }
     cout << endl;
@@ -114,29 +60,25 @@ void print_node(std::vector< std::vector <int> > bay, int m)
 
 
 
-int chkemptystack(std::vector < std::vector <int> > bay, int m)
+int chkemptystack(const bay_t & bay, int m)
 {
     int out = -1;
     for (int i = 0; i < m; i++)
     {
-        if (bay[i].size() == 0)
+        if (bay.size(i) == 0)
             out = i;
     }
     return out;      
 }
 
-int min_el_i(std::vector < std::vector <int> > bay, int i)
+/// Min block in stack \c i (read from the per-tier cache of the bay)
+int min_el_i(const bay_t & bay, int i)
 {
-    int min = _MAXRANDOM;
-    for (unsigned j = 0; j < bay[i].size(); j++)
-        if (bay[i][j] < min)
-            min = bay[i][j];
-
-    //assert(min != _MAXRANDOM);
-    return min;
+    return bay.min_el(i);
 }
 
 /// Compute a greedy score to find the new stack
+/** \return -1 if no stack is eligible (score -1) */
 int max_in_choosestack(int * choosestack, int el, int m)
 {
     int max = -1;
@@ -156,24 +98,93 @@ int max_in_choosestack(int * choosestack, int el, int m)
             pos = i;
         }
     }
-    assert(pos != -1);
-
     if (pos_min != -1)
         return pos_min;
     else
         return pos;
 }
 
-int block_heuristic(std::vector < std::vector <int> > bay, int m, int h, int nels, int k, std::vector < std::vector< std::vector<int> > > & heurPath)
+/// Stack the block on top of stack \c ki is relocated onto by the heuristic rule
+/** An empty stack if any, otherwise the stack whose min block is the
+  smallest one above the relocated block (the stack with the largest min
+  block, if none is above), among the stacks below the height limit \c h;
+  -1 if every stack other than \c ki is at the height limit.
+  */
+static inline int heuristic_target(const bay_t & bay, int m, int h, int ki, int * choosestack)
+{
+    int mptystack = chkemptystack(bay, m);
+    if (mptystack > -1)
+        return mptystack;
+
+    for (int i = 0; i < m; i++)
+        choosestack[i] = -1;
+
+    for (int i = 0; i < m; i++)
+    {
+        if (i == ki) continue;
+        if (bay.size(i) < h)
+            choosestack[i] = min_el_i(bay, i);
+    }
+
+    return max_in_choosestack(choosestack, bay.top(ki), m);
+}
+
+/// Apply a relocation (or a retrieval, if \c to is -1) and journal it
+static inline void do_move(bay_t & bay, std::vector < move_t > & moves, int from, int to)
+{
+    move_t mv = { from, to };
+    bay.apply(mv);
+    moves.push_back(mv);
+}
+
+/// Complete the retrieval process from block \c k onward with the heuristic rule
+/** The rollout is played directly on \c bay: every move is journaled in
+  \c ws.moves and, once the rollout is over, the moves are undone in
+  reverse order, so that \c bay is returned unchanged at a cost linear in
+  the number of moves performed (rather than in the size of the bay). No
+  heap allocation takes place once the work space has been sized for the
+  current bay. The moves performed (relocations and retrievals) are
+  appended to \c heurPath only when \c heurPath is not NULL.
+
+  The rollout is interrupted as soon as the relocations performed plus the
+  blocking blocks still in the bay (each of which will be relocated at
+  least once, see bay_t::n_bad) reach \c cutoff, i.e., once it is known that
+  the rollout cannot do better than \c cutoff relocations (pass INT_MAX to
+  play it out to the end). The path is then incomplete and should not be
+  used.
+
+  If a block cannot be relocated (every other stack is at the height
+  limit \c h), the rollout is infeasible and INT_MAX is returned.
+
+  If \c horizon is positive, the rollout stops once \c horizon blocks have
+  been retrieved, and the rest of the retrieval process is estimated by
+  the blocking blocks still in the bay, as above: the cost of a rollout
+  no longer grows with the size of the bay. The value is then only an
+  estimate and the path is incomplete (see cm_run::horizon_at()).
+
+  \return number of relocations performed by the heuristic (if this value
+  is not below \c cutoff, the rollout has been interrupted and the value is
+  a lower bound on the length of the complete rollout)
+  */
+int block_heuristic(bay_t & bay, int m, int h, int nels, int k, heur_scratch & ws, std::vector < move_t > * heurPath, int cutoff, int horizon)
 {
     int ki, kj;
+    int k0 = k;
+    int counter = 0;		// relocations performed (local: rollouts may run concurrently)
+    int * choosestack = ws.choosestack;
+    std::vector < move_t > & moves = ws.moves;
 
-    counter = 0;
+    moves.clear();
     // print_node(bay, m);
-    heurPath.push_back(bay);
 
-    while (k < nels)
+    int k_end = (horizon > 0 && nels - k > horizon) ? k + horizon : nels;
+    while (k < k_end)
     {
+        if (counter + bay.n_bad >= cutoff)
+        {
+            counter += bay.n_bad;	// no better than cutoff
+            break;
+        }
         
         if (!find_element(k, bay, ki, kj))
         {    
@@ -183,53 +194,101 @@ int block_heuristic(std::vector < std::vector <int> > bay, int m, int h, int nel
         // cout << "EL = " << k << " ki and ky are " << ki << " " << kj << endl;
 
         // last position 
-        if (kj == (int)bay[ki].size() - 1)
+        if (kj == bay.size(ki) - 1)
         {
-            bay[ki].pop_back();
+            do_move(bay, moves, ki, -1);
             k++;	 
         }
         else
         {
-            while (kj < (int)bay[ki].size() - 1)
+            int to = 0;
+            while (kj < bay.size(ki) - 1 && (to = heuristic_target(bay, m, h, ki, choosestack)) != -1)
+            {
+                do_move(bay, moves, ki, to);
+                counter++;
+            }
+            if (to == -1)
             {
-                int mptystack = chkemptystack(bay, m);
-                if (mptystack > -1)
-                {
-                    bay[mptystack].push_back(bay[ki][bay[ki].size()-1]);
-                    
-                    bay[ki].pop_back();
-                    counter++;
-                }
-                else
-                {
-                    int * choosestack = new int[m];
-                    for (int i = 0; i < m; i++)
-                        choosestack[i] = 0;
-
-                    for (int i = 0; i < m; i++)
-                    {
-                        if (i == ki) continue;
-                        if ((int)bay[i].size() < h)
-                            choosestack[i] = min_el_i(bay, i);
-                    }
-
-                    int newi = max_in_choosestack(choosestack, bay[ki][bay[ki].size()-1], m);
-                    bay[newi].push_back(bay[ki][bay[ki].size()-1]);
-                    bay[ki].pop_back();
-                    counter++;
-
-                    delete [] choosestack;
-                }
+                counter = _MAXRANDOM;	// infeasible rollout
+                break;
             }
             // cout << "counter now is " << counter << endl;
 
-            assert(bay[ki][bay[ki].size()-1] == k);
-            bay[ki].pop_back();
+            assert(bay.top(ki) == k);
+            do_move(bay, moves, ki, -1);
             k++;
         }
         // print_node(bay, m);
-        heurPath.push_back(bay);
     }
+    if (k == k_end && k_end < nels)
+        counter += bay.n_bad;	// truncated rollout: estimate of the rest
+    if (heurPath != NULL)
+        heurPath->insert(heurPath->end(), moves.begin(), moves.end());
+    STATS(ws.n_rollouts++);
+    STATS(ws.n_relocs += moves.size() - (k - k0));	// retrievals excluded
+    // back to the initial configuration
+    bay.rollback(moves, k0);
     return counter;
 }
 
+/// Repair the previous solution \c plan (see solution_plan()) into a solution of \c bay
+/** \c bay differs from the bay the solution was found for by some blocks
+  retrieved, added or reprioritised (see apply_changes()). The blocks are
+  retrieved in order, as in block_heuristic(); each block on top of the
+  next block to be retrieved is relocated onto the stack it was relocated
+  onto by the previous solution (its next relocation in \c plan), if that
+  stack is not at the height limit, and onto the stack chosen by the
+  heuristic rule otherwise (e.g., for a new block). \c bay is left in its
+  final state.
+
+  \return number of relocations of the repaired solution, whose moves
+  (relocations and retrievals) are written to \c path, or -1 if a block
+  of 1, ..., \c nels is not in the bay (\c bay and \c path are then
+  left partially played); -1 as well if a block cannot be relocated
+  (every other stack is at the height limit)
+  */
+int repair_solution(bay_t & bay, int m, int h, int nels, const std::vector < block_move_t > & plan, heur_scratch & ws, std::vector < move_t > & path)
+{
+    // relocations of each block, in order: first[el], then next[r], ...
+    std::vector < int > first(nels + 1, -1);
+    std::vector < int > next(plan.size(), -1);
+    for (int r = (int)plan.size() - 1; r >= 0; r--)
+        if (plan[r].el >= 1 && plan[r].el <= nels && plan[r].to >= 0)
+        {
+            next[r] = first[plan[r].el];
+            first[plan[r].el] = r;
+        }
+
+    int z = 0;
+    int ki, kj;
+    path.clear();
+    for (int k = 1; k < nels; k++)
+    {
+        if (!find_element(k, bay, ki, kj))
+            return -1;
+        while (kj < bay.size(ki) - 1)
+        {
+            int el = bay.top(ki);
+            int to = -1;
+            while (to == -1 && first[el] != -1)
+            {
+                int s = plan[first[el]].to;
+                first[el] = next[first[el]];
+                if (s >= 0 && s < m && s != ki && bay.size(s) < h)
+                    to = s;
+            }
+            if (to == -1)
+                to = heuristic_target(bay, m, h, ki, ws.choosestack);
+            if (to == -1)
+                return -1;
+            move_t mv = { ki, to };
+            bay.apply(mv);
+            path.push_back(mv);
+            z++;
+        }
+        move_t mv = { ki, -1 };
+        bay.apply(mv);
+        path.push_back(mv);
+    }
+    return z;
+}
@@ -1,10 +1,31 @@
 #ifndef heuristic_H
 #define heuristic_H
+#include <vector>
+#include "bay.h"
+#include "stats.h"
 
-int block_heuristic(std::vector < std::vector <int> > bay, int m, int h, int nels, int k, std::vector < std::vector< std::vector<int> > > & heurPath);
-bool find_element(int l, std::vector < std::vector <int> > node, int & row, int & col);
-int chkemptystack(std::vector < std::vector <int> > bay, int m);
-int min_el_i(std::vector < std::vector <int> > bay, int i);
+/// Work space of the look-ahead heuristic
+/** Owned by the caller and reused across rollouts, so that a rollout does
+  not allocate any memory once the work space has been sized for the bay.
+  */
+struct heur_scratch {
+  std::vector < move_t > moves; //!< Moves of the rollout (undone at the end)
+  int * choosestack;            //!< Score of each stack (see max_in_choosestack())
+  long n_rollouts;              //!< Rollouts played (counted only with W_STATS, see stats.h)
+  long n_relocs;                //!< Relocations performed by the rollouts (idem)
+
+  heur_scratch(int m) : choosestack(new int[m]), n_rollouts(0), n_relocs(0) {}
+  ~heur_scratch(void) { delete [] choosestack; }
+private:
+  heur_scratch(const heur_scratch &);
+  heur_scratch & operator=(const heur_scratch &);
+};
+
+int block_heuristic(bay_t & bay, int m, int h, int nels, int k, heur_scratch & ws, std::vector < move_t > * heurPath, int cutoff, int horizon = 0);
+int repair_solution(bay_t & bay, int m, int h, int nels, const std::vector < block_move_t > & plan, heur_scratch & ws, std::vector < move_t > & path);
+bool find_element(int l, const bay_t & node, int & row, int & col);
+int chkemptystack(const bay_t & bay, int m);
+int min_el_i(const bay_t & bay, int i);
 int max_in_choosestack(int * choosestack, int el, int m);
-void print_node(std::vector< std::vector<int> > bay, int m);
+void print_node(const bay_t & bay, int m);
 #endif
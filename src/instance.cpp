@@ -0,0 +1,710 @@
+/*! \file instance.cpp
+  \brief Instance loader (plain files and members of tar archives)
+
+  An instance is either a plain file or a member of a tar archive, named
+  \c archive.tar:member (e.g., data.tar:data/data3-3-1.dat), so that the
+  benchmark set can be used without extracting it. An archive is mapped
+  in memory and indexed the first time one of its members is requested,
+  and stays mapped until the end of the process.
+
+  Instances are parsed in place, from the memory mapping of the file or
+  of the archive, by a scanner reading integers directly from the bytes
+  (no stream and no copy of the data).
+
+  Besides the text format, instances and solutions can be stored in a
+  compact binary format, recognized by its magic number wherever an
+  instance is read. A binary file is a sequence of 32 bit little-endian
+  integers:
+  - header : magic "BRPB", version (BIN_VERSION), kind (BIN_INSTANCE or
+    BIN_SOLUTION)
+  - instance : \c m, \c nels, then for each stack the number of blocks
+    followed by the blocks, from the bottom up (as in the text format)
+  - solution : \c m, \c nels, number of relocations, number of moves,
+    then the \c from and \c to stacks of each move (see move_t)
+
+  The text format of a solution has the same fields: "m nels z n_moves"
+  on the first row, then one move ("from to") per row.
+
+  The changes of a bay since a previous solve (see apply_changes()) are
+  given in a text file, one change per row:
+  - "x b" : the previous solution has been carried out up to the
+    retrieval of block \c b;
+  - "r b" : block \c b has been retrieved;
+  - "a s p" : a new block has been stacked on top of stack \c s (from 0,
+    as in move_t), to be retrieved in position \c p;
+  - "p b p" : block \c b is now to be retrieved in position \c p.
+*/
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <glob.h>
+#include <fnmatch.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "instance.h"
+
+namespace {
+
+/// Map file \c path in memory (read only)
+const char * map_file(const char * path, size_t & length)
+{
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    void * p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return 0;
+    length = st.st_size;
+    return (const char *)p;
+}
+
+/// Value of an octal field of a tar header
+size_t octal(const char * field, int len)
+{
+    size_t v = 0;
+    for (int i = 0; i < len && field[i] >= '0' && field[i] <= '7'; i++)
+        v = 8*v + (field[i] - '0');
+    return v;
+}
+
+/// Next integer of \c [p, end), \c p being moved past it
+bool scan_int(const char * & p, const char * end, int & v)
+{
+    while (p < end && (*p < '0' || *p > '9') && *p != '-')
+        p++;
+    if (p == end)
+        return false;
+    bool neg = (*p == '-');
+    if (neg)
+        p++;
+    if (p == end || *p < '0' || *p > '9')
+        return false;
+    int x = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        x = 10*x + (*p++ - '0');
+    v = neg ? -x : x;
+    return true;
+}
+
+/// Next little-endian 32 bit integer of a binary file
+int get_int(const char * & p)
+{
+    const unsigned char * q = (const unsigned char *)p;
+    p += 4;
+    return (int)((uint32_t)q[0] | ((uint32_t)q[1] << 8) | ((uint32_t)q[2] << 16) | ((uint32_t)q[3] << 24));
+}
+
+/// Append \c v to \c buf as a little-endian 32 bit integer
+void put_int(std::string & buf, int v)
+{
+    uint32_t u = (uint32_t)v;
+    for (int b = 0; b < 4; b++)
+        buf += (char)((u >> (8*b)) & 0xff);
+}
+
+/// Header of a binary file of the given kind
+std::string bin_header(int kind)
+{
+    std::string buf("BRPB");
+    put_int(buf, BIN_VERSION);
+    put_int(buf, kind);
+    return buf;
+}
+
+/// Check the header of binary data and position \c p after it
+bool bin_open(const char * data, size_t size, int kind, const char * & p)
+{
+    p = data + 4;
+    if (!is_binary(data, size) || size < 12 || get_int(p) != BIN_VERSION)
+        return false;
+    return get_int(p) == kind;
+}
+
+/// Write \c buf to file \c filename
+bool write_file(const char * filename, const std::string & buf)
+{
+    FILE * f = fopen(filename, "wb");
+    if (f == 0)
+        return false;
+    bool ok = (fwrite(buf.data(), 1, buf.size(), f) == buf.size());
+    return (fclose(f) == 0) && ok;
+}
+
+/// Archives opened so far (see archive())
+std::map < std::string, tar_archive * > archives;
+std::mutex archives_mutex;
+
+/// Archive \c path, opened and indexed on first use (NULL if it cannot be read)
+const tar_archive * archive(const std::string & path)
+{
+    std::lock_guard<std::mutex> lock(archives_mutex);
+    std::map < std::string, tar_archive * >::iterator it = archives.find(path);
+    if (it != archives.end())
+        return it->second;
+    tar_archive * a = new tar_archive;
+    if (!a->open(path.c_str()))
+    {
+        delete a;
+        a = 0;
+    }
+    archives[path] = a;
+    return a;
+}
+
+/// Split \c name into \c archive.tar and member (false if not an archive member)
+bool split_member(const char * name, std::string & path, std::string & member)
+{
+    const char * sep = strstr(name, ".tar:");
+    if (sep == 0)
+        return false;
+    path.assign(name, sep + 4 - name);
+    member = sep + 5;
+    return true;
+}
+
+}
+
+tar_archive::~tar_archive(void)
+{
+    if (base != 0)
+        munmap(const_cast<char *>(base), length);
+}
+
+/// Map the archive \c path and index its regular files
+/** Both the ustar and the GNU formats are read, including the long names
+  of the GNU format (type 'L') and the name prefix of the ustar format.
+  */
+bool tar_archive::open(const char * path)
+{
+    base = map_file(path, length);
+    if (base == 0)
+        return false;
+
+    std::string long_name;
+    size_t off = 0;
+    while (off + 512 <= length && base[off] != '\0')
+    {
+        const char * hdr = base + off;
+        size_t size      = octal(hdr + 124, 12);
+        char type        = hdr[156];
+        size_t data      = off + 512;
+        if (data + size > length)
+            break;
+
+        if (type == 'L')
+            long_name.assign(base + data, strnlen(base + data, size));
+        else if (type == '0' || type == '\0')
+        {
+            member m;
+            if (!long_name.empty())
+                m.name = long_name;
+            else
+            {
+                m.name.assign(hdr, strnlen(hdr, 100));
+                if (memcmp(hdr + 257, "ustar", 5) == 0 && hdr[345] != '\0')
+                    m.name = std::string(hdr + 345, strnlen(hdr + 345, 155)) + "/" + m.name;
+            }
+            m.offset = data;
+            m.size   = size;
+            members.push_back(m);
+        }
+        if (type != 'L')
+            long_name.clear();
+        off = data + (size + 511)/512*512;
+    }
+    std::sort(members.begin(), members.end());
+    return true;
+}
+
+/// Data of member \c name (in place, not null-terminated)
+bool tar_archive::find(const std::string & name, const char * & data, size_t & size) const
+{
+    member key;
+    key.name = name;
+    std::vector < member >::const_iterator it = std::lower_bound(members.begin(), members.end(), key);
+    if (it == members.end() || it->name != name)
+        return false;
+    data = base + it->offset;
+    size = it->size;
+    return true;
+}
+
+/// Append the members matching the shell pattern \c pattern (in alphabetical order)
+void tar_archive::match(const char * pattern, std::vector < std::string > & names) const
+{
+    for (unsigned k = 0; k < members.size(); k++)
+        if (fnmatch(pattern, members[k].name.c_str(), FNM_PATHNAME) == 0)
+            names.push_back(members[k].name);
+}
+
+/// True if \c [data, data + size) is in the binary format
+bool is_binary(const char * data, size_t size)
+{
+    return size >= 4 && memcmp(data, "BRPB", 4) == 0;
+}
+
+/// True if the blocks of \c stacks are 1, ..., \c nels, each one once
+bool valid_bay(const std::vector < std::vector<int> > & stacks, int nels)
+{
+    // count first: nels is only trusted once it matches the blocks
+    size_t count = 0;
+    for (size_t i = 0; i < stacks.size(); i++)
+        count += stacks[i].size();
+    if (nels < 0 || count != (size_t)nels)
+        return false;
+    std::vector < bool > seen(count + 1, false);
+    for (size_t i = 0; i < stacks.size(); i++)
+        for (size_t j = 0; j < stacks[i].size(); j++)
+        {
+            int el = stacks[i][j];
+            if (el < 1 || el > nels || seen[el])
+                return false;
+            seen[el] = true;
+        }
+    return true;
+}
+
+/// Parse an instance from the bytes \c [data, data + size)
+/** The structure of an instance (text format) is:
+  - row 1 : number_of_stack (\c m) total_number_of_blocks (\c nels)
+  - rows 2 to \c m + 1 : number_of_blocks in stack ... list of blocks in stack
+
+  Instances in the binary format are read as well. An instance whose
+  blocks are not 1, ..., \c nels, each one once, is rejected (see
+  valid_bay()), since the solver indexes its tables by block.
+  */
+bool parse_stacks(const char * data, size_t size, std::vector < std::vector<int> > & stacks, int & nels)
+{
+    const char * p   = data;
+    const char * end = data + size;
+    int m, n_el, el;
+
+    if (is_binary(data, size))
+    {
+        if (!bin_open(data, size, BIN_INSTANCE, p) || end - p < 8)
+            return false;
+        m    = get_int(p);
+        nels = get_int(p);
+        if (m <= 0 || (size_t)m > size/4 || nels < 0 || (size_t)nels > size/4)
+            return false;
+        stacks.assign(m, std::vector<int>());
+        for (int i = 0; i < m; i++)
+        {
+            if (end - p < 4)
+                return false;
+            n_el = get_int(p);
+            if (n_el < 0 || (end - p)/4 < n_el)
+                return false;
+            stacks[i].resize(n_el);
+            for (int j = 0; j < n_el; j++)
+                stacks[i][j] = get_int(p);
+        }
+        return valid_bay(stacks, nels);
+    }
+
+    // each number takes at least two bytes (but the last one): the sizes
+    // are checked against the data before anything is allocated
+    if (!scan_int(p, end, m) || !scan_int(p, end, nels) || m <= 0 || m > (end - p + 1)/2
+        || nels < 0 || (size_t)nels > size)
+        return false;
+    stacks.assign(m, std::vector<int>());
+    for (int i = 0; i < m; i++)
+    {
+        if (!scan_int(p, end, n_el) || n_el < 0 || n_el > (end - p + 1)/2)
+            return false;
+        stacks[i].reserve(n_el);
+        for (int j = 0; j < n_el; j++)
+        {
+            if (!scan_int(p, end, el))
+                return false;
+            stacks[i].push_back(el);
+        }
+    }
+    return valid_bay(stacks, nels);
+}
+
+/// Format of file \c filename (or archive member)
+/** \return 0 for the text format, BIN_INSTANCE or BIN_SOLUTION for the
+  binary format, -1 if the file cannot be read
+  */
+int file_kind(const char * filename)
+{
+    std::string path, member;
+    const char * data;
+    size_t size;
+    int kind = -1;
+    if (split_member(filename, path, member))
+    {
+        const tar_archive * a = archive(path);
+        if (a == 0 || !a->find(member, data, size))
+            return -1;
+        kind = 0;
+        if (is_binary(data, size) && size >= 12)
+        {
+            data += 8;
+            kind = get_int(data);
+        }
+        return kind;
+    }
+
+    data = map_file(filename, size);
+    if (data == 0)
+        return -1;
+    const char * p = data + 8;
+    kind = (is_binary(data, size) && size >= 12) ? get_int(p) : 0;
+    munmap(const_cast<char *>(data), size);
+    return kind;
+}
+
+/// Read the stacks of instance \c filename (a file, or a member of a tar archive)
+bool read_stacks(const char * filename, std::vector < std::vector<int> > & stacks, int & nels)
+{
+    std::string path, member;
+    if (split_member(filename, path, member))
+    {
+        const tar_archive * a = archive(path);
+        const char * data;
+        size_t size;
+        return a != 0 && a->find(member, data, size) && parse_stacks(data, size, stacks, nels);
+    }
+
+    size_t length;
+    const char * data = map_file(filename, length);
+    if (data == 0)
+        return false;
+    bool ok = parse_stacks(data, length, stacks, nels);
+    munmap(const_cast<char *>(data), length);
+    return ok;
+}
+
+/// Instances matching \c pattern, a shell pattern of files or of archive members
+/** A pattern such as data.tar:data/data3-*.dat is matched against the
+  members of the archive, any other pattern against the file system.
+
+  \return false if no instance matches
+  */
+bool expand_instances(const char * pattern, std::vector < std::string > & names)
+{
+    std::string path, member;
+    if (split_member(pattern, path, member))
+    {
+        const tar_archive * a = archive(path);
+        if (a == 0)
+            return false;
+        std::vector < std::string > found;
+        a->match(member.c_str(), found);
+        for (unsigned k = 0; k < found.size(); k++)
+            names.push_back(path + ":" + found[k]);
+        return !found.empty();
+    }
+
+    glob_t files;
+    if (glob(pattern, 0, NULL, &files) != 0)
+        return false;
+    for (size_t f = 0; f < files.gl_pathc; f++)
+        names.push_back(files.gl_pathv[f]);
+    globfree(&files);
+    return true;
+}
+
+/// Write an instance, in the binary format if \c binary, in the text format otherwise
+bool write_stacks(const char * filename, const std::vector < std::vector<int> > & stacks, int nels, bool binary)
+{
+    if (binary)
+    {
+        std::string buf = bin_header(BIN_INSTANCE);
+        put_int(buf, stacks.size());
+        put_int(buf, nels);
+        for (unsigned i = 0; i < stacks.size(); i++)
+        {
+            put_int(buf, stacks[i].size());
+            for (unsigned j = 0; j < stacks[i].size(); j++)
+                put_int(buf, stacks[i][j]);
+        }
+        return write_file(filename, buf);
+    }
+
+    std::ofstream out(filename, std::ios::out);
+    if (!out)
+        return false;
+    out << stacks.size() << " " << nels << std::endl;
+    for (unsigned i = 0; i < stacks.size(); i++)
+    {
+        out << stacks[i].size();
+        for (unsigned j = 0; j < stacks[i].size(); j++)
+            out << " " << stacks[i][j];
+        out << std::endl;
+    }
+    return (bool)out;
+}
+
+/// Read a solution (either format) from file \c filename
+/** \c z is the number of relocations of the solution and \c moves its
+  moves, from the initial bay (see move_t).
+  */
+bool read_solution(const char * filename, int & m, int & nels, int & z, std::vector < move_t > & moves)
+{
+    size_t length;
+    const char * data = map_file(filename, length);
+    if (data == 0)
+        return false;
+    const char * p   = data;
+    const char * end = data + length;
+    int n_moves;
+    bool ok;
+
+    moves.clear();
+    if (is_binary(data, length))
+    {
+        ok = bin_open(data, length, BIN_SOLUTION, p) && end - p >= 16;
+        if (ok)
+        {
+            m       = get_int(p);
+            nels    = get_int(p);
+            z       = get_int(p);
+            n_moves = get_int(p);
+            ok      = (n_moves >= 0 && (end - p)/8 >= n_moves);
+        }
+        for (int k = 0; ok && k < n_moves; k++)
+        {
+            move_t mv;
+            mv.from = get_int(p);
+            mv.to   = get_int(p);
+            moves.push_back(mv);
+        }
+    }
+    else
+    {
+        ok = scan_int(p, end, m) && scan_int(p, end, nels) && scan_int(p, end, z)
+            && scan_int(p, end, n_moves) && n_moves >= 0;
+        for (int k = 0; ok && k < n_moves; k++)
+        {
+            move_t mv;
+            ok = scan_int(p, end, mv.from) && scan_int(p, end, mv.to);
+            moves.push_back(mv);
+        }
+    }
+    munmap(const_cast<char *>(data), length);
+    return ok;
+}
+
+/// Write a solution, in the binary format if \c binary, in the text format otherwise
+bool write_solution(const char * filename, int m, int nels, int z, const std::vector < move_t > & moves, bool binary)
+{
+    if (binary)
+    {
+        std::string buf = bin_header(BIN_SOLUTION);
+        put_int(buf, m);
+        put_int(buf, nels);
+        put_int(buf, z);
+        put_int(buf, moves.size());
+        for (unsigned k = 0; k < moves.size(); k++)
+        {
+            put_int(buf, moves[k].from);
+            put_int(buf, moves[k].to);
+        }
+        return write_file(filename, buf);
+    }
+
+    std::ofstream out(filename, std::ios::out);
+    if (!out)
+        return false;
+    out << m << " " << nels << " " << z << " " << moves.size() << std::endl;
+    for (unsigned k = 0; k < moves.size(); k++)
+        out << moves[k].from << " " << moves[k].to << std::endl;
+    return (bool)out;
+}
+
+/// Parse the changes of a bay from the bytes \c [data, data + size) (see the format above)
+bool parse_changes(const char * data, size_t size, std::vector < bay_change > & changes)
+{
+    const char * p   = data;
+    const char * end = data + size;
+
+    changes.clear();
+    for (;;)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            p++;
+        if (p == end)
+            return true;
+        bay_change c;
+        c.kind = *p++;
+        c.pos  = 0;
+        if (c.kind != 'x' && c.kind != 'r' && c.kind != 'a' && c.kind != 'p')
+            return false;
+        bool has_pos = (c.kind == 'a' || c.kind == 'p');
+        if (!scan_int(p, end, c.el) || (has_pos && !scan_int(p, end, c.pos)))
+            return false;
+        changes.push_back(c);
+    }
+}
+
+/// Read the changes of a bay from file \c filename
+bool read_changes(const char * filename, std::vector < bay_change > & changes)
+{
+    size_t length;
+    const char * data = map_file(filename, length);
+    if (data == 0)
+        return false;
+    bool ok = parse_changes(data, length, changes);
+    munmap(const_cast<char *>(data), length);
+    return ok;
+}
+
+/// Stack of block \c el (-1 if not in the bay)
+static int stack_of(const std::vector < std::vector<int> > & stacks, int el)
+{
+    for (unsigned i = 0; i < stacks.size(); i++)
+        if (std::find(stacks[i].begin(), stacks[i].end(), el) != stacks[i].end())
+            return i;
+    return -1;
+}
+
+/// Apply \c changes to the bay \c stacks, of \c nels blocks
+/** The changes are applied in the given order to the stacks and to the
+  retrieval order of the blocks: the steps of the previous solution
+  \c plan (see solution_plan()) are carried out up to the retrieval of the
+  given block ('x', the blocks left on top after the last step of the plan
+  being retrieved in order); a retrieved block is dropped from the order
+  and from its stack ('r', the blocks above it, if any, going down one
+  tier); a reprioritised block is moved to its new position; a new block
+  is inserted at its position and stacked on top of its stack. Positions
+  beyond the end of the order stand for the last one. The blocks are then
+  renumbered 1, ..., \c nels in the new retrieval order; the stacks keep
+  their index.
+
+  The steps of \c plan carried out are dropped and the others renumbered
+  (those of the retrieved blocks being dropped as well), so that the plan
+  can be repaired into a solution of the new bay (see repair_solution()).
+
+  \return false (and \c stacks partly changed) if a change refers to a
+  block that is not in the bay or to a stack that does not exist, or if
+  the plan cannot be carried out on the bay
+  */
+bool apply_changes(std::vector < std::vector<int> > & stacks, int & nels, const std::vector < bay_change > & changes,
+                   std::vector < block_move_t > * plan)
+{
+    int m = stacks.size();
+    int next = nels + 1;	// new blocks are numbered from nels + 1 until the renumbering
+    unsigned done = 0;		// steps of the plan carried out
+    std::vector < int > order(nels);
+    for (int k = 0; k < nels; k++)
+        order[k] = k + 1;
+
+    for (unsigned c = 0; c < changes.size(); c++)
+    {
+        int el = changes[c].el;
+        if (changes[c].kind == 'a')
+        {
+            if (el < 0 || el >= m)
+                return false;
+            stacks[el].push_back(next);
+            el = next++;
+        }
+        else if (changes[c].kind == 'x')
+        {
+            if (plan == 0 || el < 1 || el > nels || std::find(order.begin(), order.end(), el) == order.end())
+                return false;
+            bool over = false;
+            while (!over)
+            {
+                int b  = order.front();	// el is still in the bay
+                int to = -1;
+                if (done < plan->size())
+                {
+                    b  = (*plan)[done].el;
+                    to = (*plan)[done++].to;
+                }
+                int i = stack_of(stacks, b);
+                if (i < 0 || stacks[i].back() != b || to >= m || to == i)
+                    return false;
+                stacks[i].pop_back();
+                if (to >= 0)
+                    stacks[to].push_back(b);
+                else
+                {
+                    order.erase(std::find(order.begin(), order.end(), b));
+                    over = (b == el);
+                }
+            }
+            continue;
+        }
+        else
+        {
+            std::vector < int >::iterator it = std::find(order.begin(), order.end(), el);
+            if (el < 1 || el > nels || it == order.end())
+                return false;
+            order.erase(it);
+            if (changes[c].kind == 'r')
+            {
+                int i = stack_of(stacks, el);
+                stacks[i].erase(std::find(stacks[i].begin(), stacks[i].end(), el));
+                continue;
+            }
+        }
+        int pos = changes[c].pos - 1;
+        if (pos < 0)
+            pos = 0;
+        if (pos > (int)order.size())
+            pos = order.size();
+        order.insert(order.begin() + pos, el);
+    }
+
+    std::vector < int > label(next, 0);
+    for (unsigned k = 0; k < order.size(); k++)
+        label[order[k]] = k + 1;
+    for (int i = 0; i < m; i++)
+        for (unsigned j = 0; j < stacks[i].size(); j++)
+            stacks[i][j] = label[stacks[i][j]];
+    nels = order.size();
+    if (plan != 0)
+    {
+        unsigned kept = 0;
+        for (unsigned r = done; r < plan->size(); r++)
+        {
+            block_move_t mv = (*plan)[r];
+            if (mv.el < 1 || mv.el >= next || label[mv.el] == 0)
+                continue;
+            mv.el = label[mv.el];
+            (*plan)[kept++] = mv;
+        }
+        plan->resize(kept);
+    }
+    return true;
+}
+
+/// Steps of the solution \c moves of the bay \c stacks, identified by block
+/** \return false if a move takes a block from an empty stack or from a
+  stack that does not exist (\c plan holding the steps up to there)
+  */
+bool solution_plan(const std::vector < std::vector<int> > & stacks, const std::vector < move_t > & moves, std::vector < block_move_t > & plan)
+{
+    std::vector < std::vector<int> > bay = stacks;
+    int m = bay.size();
+
+    plan.clear();
+    for (unsigned k = 0; k < moves.size(); k++)
+    {
+        int from = moves[k].from;
+        int to   = moves[k].to;
+        if (from < 0 || from >= m || bay[from].empty() || to >= m)
+            return false;
+        block_move_t mv = { bay[from].back(), to };
+        bay[from].pop_back();
+        if (to >= 0)
+            bay[to].push_back(mv.el);
+        plan.push_back(mv);
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef instance_H
+#define instance_H
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "bay.h"
+
+/// Tar archive mapped in memory, with an index of its members
+/** The archive is mapped once (read only) and its headers are scanned
+  to build a sorted index of the regular files it contains, so that a
+  member is found by name without reading the archive again. The data of
+  a member is accessed in place.
+  */
+class tar_archive {
+public:
+  tar_archive(void) : base(0), length(0) {}
+  ~tar_archive(void);
+
+  bool open(const char * path);
+  bool find(const std::string & name, const char * & data, size_t & size) const;
+  void match(const char * pattern, std::vector < std::string > & names) const;
+
+private:
+  struct member {
+    std::string name;           //!< Path of the member within the archive
+    size_t offset;              //!< Offset of the data in the archive
+    size_t size;                //!< Size of the data (bytes)
+    bool operator<(const member & other) const { return name < other.name; }
+  };
+  std::vector < member > members; //!< Regular files, sorted by name
+  const char * base;            //!< Archive mapped in memory
+  size_t length;                //!< Size of the archive (bytes)
+
+  tar_archive(const tar_archive &);
+  tar_archive & operator=(const tar_archive &);
+};
+
+/// Change of a bay between two solves (see apply_changes())
+struct bay_change {
+  char kind;                    //!< 'x' : solution carried out, 'r' : block retrieved, 'a' : block added, 'p' : block reprioritised
+  int el;                       //!< Block of the previous bay ('x', 'r', 'p') or stack ('a', from 0)
+  int pos;                      //!< Position of the block in the new retrieval order ('a', 'p', from 1)
+};
+
+/// Binary format (see instance.cpp)
+enum { BIN_VERSION = 1, BIN_INSTANCE = 1, BIN_SOLUTION = 2 };
+
+bool is_binary(const char * data, size_t size);
+bool valid_bay(const std::vector < std::vector<int> > & stacks, int nels);
+int  file_kind(const char * filename);
+bool parse_stacks(const char * data, size_t size, std::vector < std::vector<int> > & stacks, int & nels);
+bool read_stacks(const char * filename, std::vector < std::vector<int> > & stacks, int & nels);
+bool expand_instances(const char * pattern, std::vector < std::string > & names);
+bool write_stacks(const char * filename, const std::vector < std::vector<int> > & stacks, int nels, bool binary);
+bool read_solution(const char * filename, int & m, int & nels, int & z, std::vector < move_t > & moves);
+bool write_solution(const char * filename, int m, int nels, int z, const std::vector < move_t > & moves, bool binary);
+bool parse_changes(const char * data, size_t size, std::vector < bay_change > & changes);
+bool read_changes(const char * filename, std::vector < bay_change > & changes);
+bool apply_changes(std::vector < std::vector<int> > & stacks, int & nels, const std::vector < bay_change > & changes,
+                   std::vector < block_move_t > * plan = 0);
+bool solution_plan(const std::vector < std::vector<int> > & stacks, const std::vector < move_t > & moves, std::vector < block_move_t > & plan);
+#endif
@@ -23,39 +23,117 @@
 
   Options are:
   - -f : problem instance file               [default = NONE]
-  - -t : wall-clock time limit for execution [default =  180]
+  - -t : wall-clock time limit (seconds)     [default =  60 ] (none : no limit)
   - -d : horizontal corridor width           [default =  -1 ]
-  - -v : vertical corridor width
+  - -v : rollout horizon K[,T] (blocks)      [default = 0   ] (0 : whole rollouts)
+         rollouts are whole again once at most T blocks are left [default T = 2K]
   - -n : help (list of all options)
   - -c : constant vertical corridor          [default = 1   ]
+  - -p : threads for the neighborhood search [default = 1   ]
+  - -w : trajectories built concurrently     [default = 1   ]
+  - -b : batch manifest (batch mode)         [default = NONE]
+  - -j : concurrent jobs in batch mode       [default = 1   ]
+  - -o : output file of the batch mode       [default = result.dat]
+  - -s : seed of the random number generator [default = time(0)]
+  - -z : log2 of the transposition table size [default = 20 ] (0 : no table)
+  - -e : search engine (cm, ida, beam)        [default = cm ]
+  - -k : beam width (beam engine)             [default = 10 ]
+  - -x : file the best solution is written to [default = NONE] (binary)
+  - -a : file the improvements are traced to  [default = NONE]
+  - -u : cpu time budget (seconds)           [default = none]
+  - -m : max trajectories started            [default = 0   ] (0 : none)
+  - -i : max trajectories w/o improvement    [default = 0   ] (0 : none)
+  - -g : target value of the incumbent       [default = -1  ] (-1 : none)
+  - -l : stop once the lower bound is reached [default = 1  ]
+  - -r : service mode on stdin (-) or a socket [default = NONE]
+  - -y : solution to start from (warm start)  [default = NONE]
+  - -q : changes of the bay since that solution [default = NONE]
 */
 
 #include <iostream>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
+#include "options.h"
 
 /**********************************************************/
 #define   TIME_LIMIT_def  60   //!< default wall-clock time limit
 #define   DELTA_def       -1   //!< default horizontal width
 #define   VCORR_def        1   //!< default vertical corridor
+#define   THREADS_def      1   //!< default number of threads (neighborhood)
+#define   WORKERS_def      1   //!< default number of trajectory workers
+#define   JOBS_def         1   //!< default number of concurrent batch jobs
+#define   OUTFILE_def  "result.dat" //!< default output file of the batch mode
+#define   SEED_def        -1   //!< default seed (-1 : set from the clock)
+#define   TT_BITS_def     20   //!< default log2 of the transposition table size
+#define   BEAM_WIDTH_def  10   //!< default beam width
+#define   HORIZON_def      0   //!< default rollout horizon (0 : whole rollouts)
+#define   CPU_LIMIT_def    0   //!< default cpu budget (0 : none)
+#define   TARGET_def      -1   //!< default target value (-1 : none)
 /**********************************************************/
 
 using namespace std;
 
 
 extern char* _FILENAME; 	//!< name of the instance file
-extern int time_limit;
-extern int max_ite;
-extern int n;
-extern int delta;
-extern int constantV;
+extern char* _BATCHFILE; 	//!< name of the batch manifest
+extern const char* _OUTFILE; 		//!< name of the batch output file
+extern char* _SOLFILE;		//!< name of the solution file
+extern char* _TRACEFILE;	//!< name of the trace file
+extern char* _SERVICE;		//!< endpoint of the service mode
+extern char* _STARTFILE;	//!< solution of the instance before the changes (warm start)
+extern char* _CHANGEFILE;	//!< changes of the bay applied to the instance
+extern int n_jobs;
 
-/// Parse command line options
-int parseOptions(int argc, char* argv[])
+/// Default parameters of a run
+brp_options::brp_options()
 {
-   time_limit   = TIME_LIMIT_def;
+   n            = 0;
    delta        = DELTA_def;
    constantV    = VCORR_def;
+   n_threads    = THREADS_def;
+   n_workers    = WORKERS_def;
+   seed         = SEED_def;
+   tt_bits      = TT_BITS_def;
+   engine       = ENGINE_CM;
+   beam_width   = BEAM_WIDTH_def;
+   horizon      = HORIZON_def;
+   horizon_full = -1;
+   stop.wall    = TIME_LIMIT_def;
+   stop.cpu     = CPU_LIMIT_def;
+   stop.target  = TARGET_def;
+   quiet        = true;
+   tracing      = false;
+}
+
+/// Seconds of a time budget: a positive number, or "none" (no limit, 0 in stop_policy)
+bool parse_budget(const char * arg, double & seconds)
+{
+   if (arg == NULL)
+      return false;
+   if (strcmp(arg, "none") == 0)
+   {
+      seconds = 0;
+      return true;
+   }
+   char * end;
+   seconds = strtod(arg, &end);
+   return end != arg && *end == '\0' && seconds > 0.0;
+}
+
+/// Parse command line options (the parameters of the run go to \c opt)
+int parseOptions(int argc, char* argv[], brp_options & opt)
+{
+   opt          = brp_options();
+   opt.quiet    = false;
+   n_jobs       = JOBS_def;
+   _BATCHFILE   = NULL;
+   _OUTFILE     = OUTFILE_def;
+   _SOLFILE     = NULL;
+   _TRACEFILE   = NULL;
+   _SERVICE     = NULL;
+   _STARTFILE   = NULL;
+   _CHANGEFILE  = NULL;
    bool setFile = false;
    bool setVert = false;
 
@@ -85,20 +163,131 @@ int parseOptions(int argc, char* argv[])
 	       i++;
 	       break;
 	    case 't':
-	       time_limit = atol(argv[i+1]);
+	       if (!parse_budget(argv[i+1], opt.stop.wall))
+	       {
+		  cout << "Option -t : positive number of seconds, or none" << endl;
+		  return -1;
+	       }
 	       i++;
 	       break;
 	    case 'd':
-	       delta = atol(argv[i+1]);
+	       opt.delta = atol(argv[i+1]);
 	       i++;
 	       break;
 	    case 'n':
-	       n = atol(argv[i+1]);
+	       opt.n = atol(argv[i+1]);
 	       setVert = true;
 	       i++;
 	       break;
 	    case 'c':
-	       constantV = atol(argv[i+1]);
+	       opt.constantV = atol(argv[i+1]);
+	       i++;
+	       break;
+	    case 'p':
+	       opt.n_threads = atol(argv[i+1]);
+	       if (opt.n_threads < 1)
+	       {
+		  cout << "Option -p : at least 1 thread" << endl;
+		  return -1;
+	       }
+	       i++;
+	       break;
+	    case 'w':
+	       opt.n_workers = atol(argv[i+1]);
+	       if (opt.n_workers < 1)
+	       {
+		  cout << "Option -w : at least 1 trajectory worker" << endl;
+		  return -1;
+	       }
+	       i++;
+	       break;
+	    case 'b':
+	       _BATCHFILE = argv[i+1];
+	       i++;
+	       break;
+	    case 'j':
+	       n_jobs = atol(argv[i+1]);
+	       if (n_jobs < 1)
+	       {
+		  cout << "Option -j : at least 1 job" << endl;
+		  return -1;
+	       }
+	       i++;
+	       break;
+	    case 'o':
+	       _OUTFILE = argv[i+1];
+	       i++;
+	       break;
+	    case 's':
+	       opt.seed = atol(argv[i+1]);
+	       i++;
+	       break;
+	    case 'z':
+	       opt.tt_bits = atol(argv[i+1]);
+	       i++;
+	       break;
+	    case 'e':
+	       if (strcmp(argv[i+1], "cm") == 0)
+		  opt.engine = ENGINE_CM;
+	       else if (strcmp(argv[i+1], "ida") == 0)
+		  opt.engine = ENGINE_IDA;
+	       else if (strcmp(argv[i+1], "beam") == 0)
+		  opt.engine = ENGINE_BEAM;
+	       else
+		  return i;
+	       i++;
+	       break;
+	    case 'k':
+	       opt.beam_width = atol(argv[i+1]);
+	       i++;
+	       break;
+	    case 'x':
+	       _SOLFILE = argv[i+1];
+	       i++;
+	       break;
+	    case 'a':
+	       _TRACEFILE = argv[i+1];
+	       i++;
+	       break;
+	    case 'r':
+	       _SERVICE = argv[i+1];
+	       i++;
+	       break;
+	    case 'v':
+	       opt.horizon = atol(argv[i+1]);
+	       opt.horizon_full = (strchr(argv[i+1], ',') != NULL) ? atol(strchr(argv[i+1], ',') + 1) : -1;
+	       i++;
+	       break;
+	    case 'y':
+	       _STARTFILE = argv[i+1];
+	       i++;
+	       break;
+	    case 'q':
+	       _CHANGEFILE = argv[i+1];
+	       i++;
+	       break;
+	    case 'u':
+	       if (!parse_budget(argv[i+1], opt.stop.cpu))
+	       {
+		  cout << "Option -u : positive number of seconds, or none" << endl;
+		  return -1;
+	       }
+	       i++;
+	       break;
+	    case 'm':
+	       opt.stop.trajectories = atol(argv[i+1]);
+	       i++;
+	       break;
+	    case 'i':
+	       opt.stop.stall = atol(argv[i+1]);
+	       i++;
+	       break;
+	    case 'g':
+	       opt.stop.target = atol(argv[i+1]);
+	       i++;
+	       break;
+	    case 'l':
+	       opt.stop.at_lb = (atol(argv[i+1]) != 0);
 	       i++;
 	       break;
 	    case 'h':
@@ -106,19 +295,39 @@ int parseOptions(int argc, char* argv[])
 	       cout << "-f : problem instance file" << endl;
 	       cout << "-d : horizontal corridor width" << endl;
 	       cout << "-n : vertical corridor width" << endl;
-	       cout << "-t : time limit (real)" << endl;
+	       cout << "-t : wall-clock time limit (seconds, fractions allowed; none : no limit)" << endl;
 	       cout << "-c : constant vertical corridor (1 : true; 0 : false)" << endl;
+	       cout << "-p : number of threads for the neighborhood search" << endl;
+	       cout << "-w : number of trajectories built concurrently" << endl;
+	       cout << "-b : batch manifest (batch mode, see run_batch())" << endl;
+	       cout << "-j : number of jobs solved concurrently (batch mode)" << endl;
+	       cout << "-o : output file (batch mode)" << endl;
+	       cout << "-s : seed of the random number generator" << endl;
+	       cout << "-z : log2 of the transposition table size (0 : no table)" << endl;
+	       cout << "-e : search engine (cm : corridor method; ida : exact IDA*; beam : beam search)" << endl;
+	       cout << "-k : beam width (beam engine)" << endl;
+	       cout << "-x : file the best solution is written to (binary format)" << endl;
+	       cout << "-a : file the improvements of the incumbent are traced to" << endl;
+	       cout << "-u : cpu time budget (seconds, fractions allowed; none : no limit)" << endl;
+	       cout << "-m : max number of trajectories (0 : none)" << endl;
+	       cout << "-i : max number of trajectories without improvement (0 : none)" << endl;
+	       cout << "-g : stop once the incumbent reaches this value (-1 : none)" << endl;
+	       cout << "-l : stop once the lower bound is reached (1 : true; 0 : false)" << endl;
+	       cout << "-r : service mode, requests read from stdin (-) or a Unix socket (see service.cpp)" << endl;
+	       cout << "-v : rollout horizon K[,T] (blocks; rollouts are whole once at most T blocks are left, default 2K)" << endl;
+	       cout << "-y : solution of the instance (before the changes of -q) to start from (warm start)" << endl;
+	       cout << "-q : changes of the bay applied to the instance (see apply_changes())" << endl;
 	       cout << endl;
 	       return -1;
 	 }
       }
    }
  
-   if (setFile && setVert)
+   if ((setFile && setVert) || _BATCHFILE != NULL || _SERVICE != NULL)
       return 0;
    else
    {
-      cout <<"Options -f and -n are mandatory. Try -h" << endl;
+      cout <<"Options -f and -n (or -b, or -r) are mandatory. Try -h" << endl;
       return -1;
    }
 
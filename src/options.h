@@ -22,12 +22,49 @@
 \brief Header file of options.cpp
 
 */
-extern char* _FILENAME;
-extern int time_limit;
-extern int n;
-extern int delta;
-extern int constantV;
+#ifndef options_H
+#define options_H
+#include "stop.h"
+
+/// Search engines (option -e)
+enum { ENGINE_CM, ENGINE_IDA, ENGINE_BEAM };
 
-int parseOptions(int argc, char* argv[]);
+/// Parameters of a run (see cm_run and brp_solver)
+/** Set from the command line by parseOptions(), or directly by a program
+  embedding the solver (see solver.h); the defaults are those of the
+  command line.
+  */
+struct brp_options
+{
+  int n;			//!< Max height of each stack (number of empty tiers if constantV = 0)
+  int delta;			//!< Max horizontal width corridor (-1 : whole bay)
+  int constantV;		//!< Vertical corridor type (1 : constant; 0 : variable)
+  int n_threads;		//!< Number of threads for the neighborhood search
+  int n_workers;		//!< Number of trajectories built concurrently
+  long seed;			//!< Seed of the run (-1 : set from the clock by the caller)
+  int tt_bits;			//!< log2 of the transposition table size (0 : no table)
+  int engine;			//!< Search engine (ENGINE_CM, ENGINE_IDA or ENGINE_BEAM)
+  int beam_width;		//!< Number of states kept by the beam engine
+  int horizon;			//!< Blocks retrieved by a rollout before the rest is estimated (0 : whole rollouts)
+  int horizon_full;		//!< Remaining blocks from which rollouts are whole again (-1 : twice the horizon)
+  stop_policy stop;		//!< When to stop the run (see stop.h)
+  bool quiet;			//!< Do not print the parameters and the improvements on screen
+  bool tracing;			//!< Keep the improvements of the incumbent (see brp_result::trace)
 
+  brp_options();
+};
+
+// input and output files of the command line program (see containers.cpp)
+extern char* _FILENAME;
+extern char* _BATCHFILE;
+extern const char* _OUTFILE;
+extern char* _SOLFILE;
+extern char* _TRACEFILE;
+extern char* _SERVICE;
+extern char* _STARTFILE;
+extern char* _CHANGEFILE;
+extern int n_jobs;
 
+bool parse_budget(const char * arg, double & seconds);
+int parseOptions(int argc, char* argv[], brp_options & opt);
+#endif
@@ -0,0 +1,80 @@
+#include "pool.h"
+
+task_pool::task_pool(int n_workers_) : n_workers(n_workers_ < 1 ? 1 : n_workers_),
+  generation(0), busy(0), stop(false), job(0), arg(0), n_tasks(0), next(0)
+{
+  for (int w = 1; w < n_workers; w++)
+    threads.push_back(std::thread(&task_pool::loop, this, w));
+}
+
+task_pool::~task_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cv_start.notify_all();
+  for (unsigned k = 0; k < threads.size(); k++)
+    threads[k].join();
+}
+
+void
+task_pool::run(int n_tasks_, job_t job_, void * arg_)
+{
+  if (n_workers == 1 || n_tasks_ <= 1)
+  {
+    for (int t = 0; t < n_tasks_; t++)
+      job_(t, 0, arg_);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    job     = job_;
+    arg     = arg_;
+    n_tasks = n_tasks_;
+    next    = 0;
+    busy    = n_workers - 1;
+    generation++;
+  }
+  cv_start.notify_all();
+  work(0);
+
+  std::unique_lock<std::mutex> lock(mtx);
+  while (busy > 0)
+    cv_done.wait(lock);
+}
+
+/*
+ *  Each thread sleeps until a new batch is started, takes tasks until the
+ *  batch is exhausted and signals the caller when it is done.
+ */
+void
+task_pool::loop(int worker)
+{
+  long seen = 0;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      while (!stop && generation == seen)
+	cv_start.wait(lock);
+      if (stop)
+	return;
+      seen = generation;
+    }
+    work(worker);
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      if (--busy == 0)
+	cv_done.notify_one();
+    }
+  }
+}
+
+void
+task_pool::work(int worker)
+{
+  int t;
+  while ((t = next++) < n_tasks)
+    job(t, worker, arg);
+}
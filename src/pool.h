@@ -0,0 +1,46 @@
+#ifndef pool_H
+#define pool_H
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/// Fixed set of worker threads running batches of independent tasks
+/** run() hands out the tasks \c 0, ..., \c n_tasks-1 of a batch to the
+  workers and returns once all of them are completed. The calling thread
+  takes part in the batch as worker 0, so a pool of size 1 has no thread
+  at all and runs every task in the caller. Threads are created once and
+  sleep between batches.
+  */
+class task_pool {
+public:
+  typedef void (*job_t)(int task, int worker, void * arg);
+
+  task_pool(int n_workers);
+  ~task_pool();
+  /// Number of workers (including the calling thread)
+  int size(void) const { return n_workers; }
+  /// Run \c job(task, worker, arg) for every task of the batch and wait
+  void run(int n_tasks, job_t job, void * arg);
+
+private:
+  int n_workers;
+  std::vector<std::thread> threads;
+  std::mutex mtx;
+  std::condition_variable cv_start;
+  std::condition_variable cv_done;
+  long generation;              //!< Number of batches started so far
+  int  busy;                    //!< Threads still working on the current batch
+  bool stop;
+  job_t job;
+  void * arg;
+  int n_tasks;
+  std::atomic<int> next;        //!< Next task of the batch to hand out
+
+  void loop(int worker);
+  void work(int worker);
+  task_pool(const task_pool &);
+  task_pool & operator=(const task_pool &);
+};
+#endif
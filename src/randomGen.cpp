@@ -20,6 +20,8 @@
 /*! \file randomGen.cpp
   \brief Generation of random instances
   
+  The instance is written in the text format, or in the binary format of
+  instance.cpp if -b is given.
 */
 
 #include <iostream>
@@ -27,6 +29,9 @@
 #include <fstream>
 #include <cstring>
 #include <ctime>
+#include <cstdlib>
+#include <vector>
+#include "instance.h"
 
 //#define M_DEBUG	/*!< Comment this to remove debug */
 
@@ -34,6 +39,7 @@ using namespace std;
 
 /************************ Global Constants *******************/
 const char* RESULT_FILE = "data/data_random.dat";
+const char* RESULT_FILE_BIN = "data/data_random.brp";
 /************************ Global Constants *******************/
 
 int parseOptionsRandom(int argc, char* argv[]);
@@ -44,6 +50,7 @@ int parseOptionsRandom(int argc, char* argv[]);
 int m;				//!< Number of stacks
 int h;				//!< Number of teils
 int n;				//!< Total number of blocks
+bool binary = false;		//!< Write the binary format
 //===========================================================
 //23456789012345678901234567890123456789012345678901234567890
 //===========================================================
@@ -96,24 +103,17 @@ int main(int argc, char *argv[])
       }
    }
 
-   ofstream fOutput(RESULT_FILE, ios::out);
-   if (!fOutput)
-   {
-      cerr << "Cannot open file " << RESULT_FILE << endl;
-      exit(1);
-   }
-
-   fOutput << m << " " << n << endl;
+   std::vector< std::vector<int> > stacks(m);
    for (int i = 0; i < m; i++)
+      stacks[i].assign(y[i], y[i] + h);
+
+   const char * filename = binary ? RESULT_FILE_BIN : RESULT_FILE;
+   if (!write_stacks(filename, stacks, n, binary))
    {
-      fOutput << h;
-      for (int j = 0; j < h; j++)
-	 fOutput << " " << y[i][j]; 
-      fOutput << endl;
+      cerr << "Cannot open file " << filename << endl;
+      exit(1);
    }
 
-   fOutput.close();
-
    cout << "Random bay of size " << m << " x " << h << " has been generated." << endl;
 
    delete [] y;
@@ -156,10 +156,14 @@ int parseOptionsRandom(int argc, char* argv[])
 	       seth = true;
 	       i++;
 	       break;
+	    case 'b':
+	       binary = true;
+	       break;
 	    case 'l':
 	       cout << "OPTIONS :: " << endl;
 	       cout << "-m : number of stacks" << endl;
 	       cout << "-h : number of tiers" << endl;
+	       cout << "-b : write the binary format" << endl;
 	       cout << endl;
 	       return -1;
 	 }
@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   Copyright (C) 2008 by Marco Caserta                                   *
+ *   marco dot caserta at uni-hamburg dot de                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*! \file rng.h
+  \brief Seedable pseudo-random number generator (xoshiro256**)
+
+  Each object owns its own state, so that every thread can draw from its
+  own stream without any locking (unlike rand(), whose state is shared
+  by the whole process).
+
+  The 256 bits of state are filled from a 64 bit seed with splitmix64.
+  Independent streams are obtained from the same seed with jump(), which
+  is equivalent to 2^128 calls to next(): stream \c k (see rng_t(seed, k))
+  is the sequence of the master seed after \c k jumps, hence the streams
+  never overlap in practice.
+
+  See D. Blackman and S. Vigna, "Scrambled linear pseudorandom number
+  generators", ACM Transactions on Mathematical Software, 47(4), 2021.
+*/
+#ifndef rng_H
+#define rng_H
+#include <stdint.h>
+
+/// Mix a 64 bit value (splitmix64 output function)
+inline uint64_t splitmix64(uint64_t & x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+class rng_t {
+public:
+  uint64_t s[4];                //!< State of the generator
+
+  /// Stream \c stream of the master seed \c seed
+  explicit rng_t(uint64_t seed = 0, int stream = 0) { set_seed(seed, stream); }
+
+  /// Restart the generator on stream \c stream of the master seed \c seed
+  void set_seed(uint64_t seed, int stream = 0)
+  {
+    for (int i = 0; i < 4; i++)
+      s[i] = splitmix64(seed);
+    for (int k = 0; k < stream; k++)
+      jump();
+  }
+
+  /// Next 64 bit value
+  uint64_t next()
+  {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  /// Uniform value in [0, 1) (53 bits of precision)
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+  /// Advance the state by 2^128 values (start of the next stream)
+  void jump()
+  {
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+      0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+    uint64_t t[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 4; i++)
+      for (int b = 0; b < 64; b++)
+      {
+        if (JUMP[i] & ((uint64_t)1 << b))
+          for (int j = 0; j < 4; j++)
+            t[j] ^= s[j];
+        next();
+      }
+    for (int j = 0; j < 4; j++)
+      s[j] = t[j];
+  }
+
+private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+#endif
@@ -0,0 +1,309 @@
+/*! \file service.cpp
+  \brief Service mode: solve the bays sent on stdin or on a Unix socket
+
+  The solver keeps running and answers requests, so that the cost of
+  starting a process, parsing the options and setting up the threads and
+  the transposition table is paid once (see brp_session). With option -r
+  the requests are read from stdin and the replies written to stdout
+  ("-r -"), or exchanged on a Unix socket ("-r path"), whose clients are
+  served one after the other.
+
+  A request is a header row followed by the instance:
+  \verbatim
+  solve <id> <bytes> [t=<seconds>] [d=<width>] [n=<height>] [s=<seed>] [g=<target>] [v=<horizon>]
+  <bytes bytes: the instance, in the text or in the binary format>
+  \endverbatim
+  where \c id is any word, echoed in the reply, \c seconds is the time
+  budget of the request (positive, fractions allowed), \c width is -1
+  (whole bay) or positive, and \c height is either an absolute max
+  height or "+k", i.e., \c k tiers above the tallest initial stack;
+  \c horizon is the number of blocks retrieved by a rollout (see
+  cm_run::horizon_at()). Missing fields are taken from the command line
+  (the height being "+2" if -n is not given); a field out of range is
+  an error. The reply is
+  \verbatim
+  ok <id> <z> <lb> <time> <n_moves>
+  <from> <to>   (n_moves rows, to = -1 being a retrieval, see move_t)
+  \endverbatim
+  or "error <id> <message>" if the request cannot be served. The row
+  "quit" closes the connection (on stdin, it stops the service). So does
+  a header whose command or byte count cannot be parsed, or announcing
+  more than MAX_REQUEST bytes, after the error reply: the start of the
+  next request cannot be told.
+
+  The last bay solved and its solution are kept, so that a bay that has
+  changed since is re-solved from there (see cm_run::warm_start()):
+  \verbatim
+  update <id> <bytes> [fields]
+  <bytes bytes: the changes of the last bay, see apply_changes()>
+  \endverbatim
+  solves the last bay with the changes applied (none if \c bytes is 0),
+  starting from the last solution; the field "w=1" of a solve request
+  starts from the last solution as well, the blocks keeping their number.
+  The reply is the same as for a solve request, the blocks of the bay
+  being renumbered as explained in apply_changes().
+*/
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "instance.h"
+#include "solver.h"
+
+using namespace std;
+
+#define   MAX_REQUEST   (64L << 20)   //!< max bytes of the data of a request
+
+/// Read a row of \c in (without the newline) into \c line
+static bool read_line(FILE * in, std::string & line)
+{
+    line.clear();
+    int c;
+    while ((c = getc(in)) != EOF && c != '\n')
+        line += (char)c;
+    return c != EOF || !line.empty();
+}
+
+/// Integer \c v written in \c str (all of it), in [\c lo, \c hi]
+static bool parse_long(const char * str, long lo, long hi, long & v)
+{
+    char * end;
+    errno = 0;
+    v = strtol(str, &end, 10);
+    return end != str && *end == '\0' && errno == 0 && v >= lo && v <= hi;
+}
+
+/// Positive number of seconds \c v written in \c str (all of it)
+static bool parse_seconds(const char * str, double & v)
+{
+    char * end;
+    errno = 0;
+    v = strtod(str, &end);
+    return end != str && *end == '\0' && errno == 0 && v > 0.0 && v < 1.0E9;
+}
+
+/// Serve the requests of \c in, replying on \c out, until "quit" or the end of \c in
+/** \c last is the last bay solved and \c last.start the relocations of its solution. */
+static void serve(FILE * in, FILE * out, brp_session & session, const brp_options & base, brp_instance & last)
+{
+    std::string line, cmd, id, item, field;
+    std::vector < char > data;
+    std::vector < bay_change > changes;
+
+    while (read_line(in, line))
+    {
+        std::stringstream ss(line);
+        if (!(ss >> cmd))
+            continue;
+        if (cmd == "quit")
+            return;
+        long bytes = -1;
+        bool update = (cmd == "update");
+        id = "-";
+        if ((cmd != "solve" && !update) || !(ss >> id >> field)
+            || !parse_long(field.c_str(), update ? 0 : 1, LONG_MAX, bytes))
+        {
+            // the length of the data is unknown: the stream is lost
+            fprintf(out, "error %s wrong request\n", id.c_str());
+            fflush(out);
+            return;
+        }
+        if (bytes > MAX_REQUEST)
+        {
+            fprintf(out, "error %s request too large\n", id.c_str());
+            fflush(out);
+            return;
+        }
+        data.resize(bytes + 1);
+        if (fread(&data[0], 1, bytes, in) != (size_t)bytes)
+            return;		// connection closed in the middle of a request
+
+        brp_options opt = base;
+        std::string height = "";
+        bool ok = true;
+        bool warm = update;
+        while (ok && ss >> item)
+        {
+            const char * value = item.c_str() + 2;
+            long v;
+            if (item.size() < 2 || item[1] != '=')
+                ok = false;
+            else if (item[0] == 't')
+                ok = parse_seconds(value, opt.stop.wall);
+            else if (item[0] == 'd')
+            {
+                ok = parse_long(value, -1, INT_MAX, v) && v != 0;
+                opt.delta = v;
+            }
+            else if (item[0] == 'n')
+            {
+                height = value;
+                ok = parse_long(value + (value[0] == '+'), (value[0] == '+') ? 0 : 1, INT_MAX, v);
+            }
+            else if (item[0] == 's')
+            {
+                ok = parse_long(value, LONG_MIN, LONG_MAX, v);
+                opt.seed = v;
+            }
+            else if (item[0] == 'g')
+            {
+                ok = parse_long(value, -1, INT_MAX, v);
+                opt.stop.target = v;
+            }
+            else if (item[0] == 'v')
+            {
+                ok = parse_long(value, 0, INT_MAX, v);
+                opt.horizon = v;
+                opt.horizon_full = -1;
+            }
+            else if (item[0] == 'w')
+            {
+                ok = parse_long(value, 0, 1, v);
+                warm = (v != 0);
+            }
+            else
+                ok = false;
+        }
+        brp_instance inst;
+        const char * error = NULL;
+        if (!ok)
+            error = "wrong field";
+        else if (update)
+        {
+            inst = last;
+            if (last.stacks.empty())
+                error = "no previous bay";
+            else if (!parse_changes(&data[0], bytes, changes) || !apply_changes(inst.stacks, inst.nels, changes, &inst.start))
+                error = "wrong changes";
+        }
+        else if (!parse_stacks(&data[0], bytes, inst.stacks, inst.nels))
+            error = "wrong instance";
+        if (error != NULL)
+        {
+            fprintf(out, "error %s %s\n", id.c_str(), error);
+            fflush(out);
+            continue;
+        }
+        inst.name = id;
+        if (!warm)
+            inst.start.clear();
+        else if (!update)
+            inst.start = last.start;
+        int H = 0;
+        for (unsigned i = 0; i < inst.stacks.size(); i++)
+            if ((int)inst.stacks[i].size() > H)
+                H = inst.stacks[i].size();
+        if (height.empty())
+            opt.n = (base.n > 0) ? base.n : H + 2;
+        else if (height[0] == '+')
+            opt.n = H + atoi(height.c_str() + 1);
+        else
+            opt.n = atoi(height.c_str());
+        if (opt.n < H)
+        {
+            fprintf(out, "error %s height below the initial bay\n", id.c_str());
+            fflush(out);
+            continue;
+        }
+
+        brp_result res = session.solve(inst, opt);
+        if (res.z == INT_MAX)
+        {
+            fprintf(out, "error %s no solution found within the height limit\n", id.c_str());
+            fflush(out);
+            continue;
+        }
+        last = inst;
+        solution_plan(last.stacks, res.moves, last.start);
+        fprintf(out, "ok %s %d %d %.4f %d\n", id.c_str(), res.z, res.lb, res.wall, (int)res.moves.size());
+        for (unsigned k = 0; k < res.moves.size(); k++)
+            fprintf(out, "%d %d\n", res.moves[k].from, res.moves[k].to);
+        fflush(out);
+    }
+}
+
+/// Service mode: serve the requests on stdin ("-") or on the Unix socket \c endpoint
+/** The parameters of the command line are the defaults of each request;
+  the bays are solved one at a time on the same session. A socket left
+  at \c endpoint (e.g., by a previous service) is replaced, but the
+  service does not start if \c endpoint is any other kind of file.
+  */
+int run_service(const brp_options & opt, const char * endpoint)
+{
+    brp_options base = opt;
+    base.quiet   = true;
+    base.tracing = false;
+    brp_session session(base);
+    brp_instance last;
+
+    if (strcmp(endpoint, "-") == 0)
+    {
+        serve(stdin, stdout, session, base, last);
+        return 0;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(endpoint) >= sizeof(addr.sun_path))
+    {
+        cerr << "Socket path too long " << endpoint << endl;
+        return 1;
+    }
+    strcpy(addr.sun_path, endpoint);
+    // a stale socket (e.g., of a previous service) is replaced, any other
+    // file is left alone
+    struct stat st;
+    if (lstat(endpoint, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            cerr << "Cannot listen on " << endpoint << " (not a socket)" << endl;
+            return 1;
+        }
+        unlink(endpoint);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0)
+    {
+        cerr << "Cannot listen on " << endpoint << " (" << strerror(errno) << ")" << endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);	// a client may leave before its reply
+    cerr << "CM : Service listening on " << endpoint << endl;
+
+    for (;;)
+    {
+        int c = accept(fd, NULL, NULL);
+        if (c < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            cerr << "Cannot accept on " << endpoint << " (" << strerror(errno) << ")" << endl;
+            break;
+        }
+        FILE * in  = fdopen(c, "r");
+        FILE * out = fdopen(dup(c), "w");
+        if (in != NULL && out != NULL)
+            serve(in, out, session, base, last);
+        if (in != NULL)
+            fclose(in);
+        else
+            close(c);
+        if (out != NULL)
+            fclose(out);
+    }
+    close(fd);
+    unlink(endpoint);
+    return 1;
+}
@@ -0,0 +1,165 @@
+/*! \file solver.cpp
+  \brief Solver library (see solver.h) and output of the results
+
+  brp_solver::solve() sets up a run (see cm_run) with the options of the
+  solver, solves it and copies the outcome to a brp_result, so that
+  nothing of the run outlives the call; brp_session::solve() does the same
+  on the run of the session, which is kept. The result row (result.dat), the
+  counters (JSON) and the anytime trace of a run are written from its
+  brp_result.
+*/
+#include <iostream>
+#include <iomanip>
+#include "instance.h"
+#include "containers.h"
+#include "solver.h"
+
+using namespace std;
+
+static brp_result solve_run(cm_run & run, const brp_instance & inst);
+
+/// Read the bay from \c filename (see read_stacks())
+bool brp_instance::read(const char * filename)
+{
+    name = filename;
+    return read_stacks(filename, stacks, nels);
+}
+
+/// Solve the bay of \c inst
+/** Every call is an independent run: the solver itself is not modified,
+  and calls from different threads may overlap.
+  */
+brp_result brp_solver::solve(const brp_instance & inst) const
+{
+    cm_run run(opt);
+    return solve_run(run, inst);
+}
+
+brp_session::brp_session(const brp_options & opt) : run(new cm_run(opt)) {}
+
+brp_session::~brp_session()
+{
+    delete run;
+}
+
+/// Solve the bay of \c inst with the parameters \c opt, on the run of the session
+brp_result brp_session::solve(const brp_instance & inst, const brp_options & opt)
+{
+    run->configure(opt);
+    return solve_run(*run, inst);
+}
+
+/// Solve \c inst on \c run and collect the outcome
+static brp_result solve_run(cm_run & run, const brp_instance & inst)
+{
+    run.name = inst.name.c_str();
+    run.set_bay(inst.stacks, inst.nels);
+    run.start = inst.start;
+    run.solve();
+
+    brp_result res;
+    res.name         = inst.name;
+    res.m            = run.m;
+    res.nels         = run.nels;
+    res.delta        = run.delta;
+    res.z            = run.best_z;
+    res.start_z      = run.start_z;
+    res.lb           = run.lb;
+    res.optimal      = run.optimal();
+    res.best_time    = run.best_time;
+    res.wall         = run.run_time;
+    res.stop_reason  = run.stop_reason;
+    res.trajectories = run.n_trajectories;
+    res.nodes        = run.n_nodes;
+    res.tt_probes    = run.tt_probes;
+    res.tt_hits      = run.tt_hits;
+    res.stats        = run.stats;
+    res.moves.swap(run.bestPath);
+    res.trace.swap(run.trace);
+    return res;
+}
+
+/// Write the result row of the run (format of result.dat)
+/** The row ends with the lower bound of the instance, the gap (z - lb)
+  and a flag set to 1 if the solution is proven optimal.
+  */
+void write_result(ostream & out, const brp_options & opt, const brp_result & res)
+{
+    out << setw(12) << res.name << setw(4) << res.m << setw(4) << opt.n << setw(4)
+        << res.nels << setw(12) << res.z << setw(10)
+        << res.delta << setw(15) << setprecision(3)
+        << res.best_time << setw(6) << res.lb << setw(6) << res.z - res.lb
+        << setw(3) << res.optimal << endl;
+}
+
+/// Write \c str as a JSON string
+static void write_json_string(ostream & out, const std::string & str)
+{
+    out << '"';
+    for (size_t c = 0; c < str.size(); c++)
+    {
+        if (str[c] == '"' || str[c] == '\\')
+            out << '\\';
+        out << str[c];
+    }
+    out << '"';
+}
+
+/// Write the counters of the run as a JSON object (see stats.h)
+/** The times of the corridor definition, of the rollouts and of the
+  bookkeeping (the rest of the time of the trajectory workers) are summed
+  over the trajectory workers; \c wall is the wall-clock time of the run,
+  whereas \c best_time is read on the clock of cm_run::elapsed_time(),
+  i.e., the cpu time of the search in a single-threaded run. The
+  corridor width is the number of stacks actually evaluated, i.e., after
+  the stacks at the height limit have been dropped. The peak memory is the
+  one of the whole process.
+  */
+void write_stats(ostream & out, const brp_options & opt, const brp_result & res)
+{
+    static const char * engine_name[] = { "cm", "ida", "beam" };
+    static const char * stop_name[] = { "none", "lb", "target", "wall", "cpu", "trajectories", "stall" };
+    const run_stats & stats = res.stats;
+    double bookkeeping = stats.t_total - stats.t_corridor - stats.t_rollout;
+
+    out << "{\"instance\": ";
+    write_json_string(out, res.name);
+    out << setprecision(6)
+        << ", \"engine\": \"" << engine_name[opt.engine] << "\""
+        << ", \"m\": " << res.m << ", \"n\": " << opt.n << ", \"nels\": " << res.nels
+        << ", \"delta\": " << res.delta << ", \"threads\": " << opt.n_threads
+        << ", \"workers\": " << opt.n_workers << ", \"seed\": " << opt.seed
+        << ", \"horizon\": " << opt.horizon
+        << ", \"best_z\": " << res.z << ", \"best_time\": " << res.best_time
+        << ", \"start_z\": " << res.start_z
+        << ", \"lb\": " << res.lb << ", \"optimal\": " << (res.optimal ? "true" : "false")
+        << ", \"wall\": " << res.wall << ", \"stop\": \"" << stop_name[res.stop_reason] << "\""
+        << ", \"trajectories\": " << res.trajectories << ", \"fathomed\": " << stats.fathomed
+        << ", \"neighborhoods\": " << stats.neighborhoods
+        << ", \"rollouts\": " << stats.rollouts
+        << ", \"rollout_relocations\": " << stats.rollout_relocs
+        << ", \"corridor\": {\"min\": " << stats.corridor_min
+        << ", \"mean\": " << ((stats.neighborhoods > 0) ? (double)stats.corridor_sum/stats.neighborhoods : 0.0)
+        << ", \"max\": " << stats.corridor_max << "}"
+        << ", \"time\": {\"corridor\": " << stats.t_corridor
+        << ", \"rollout\": " << stats.t_rollout
+        << ", \"bookkeeping\": " << ((bookkeeping > 0.0) ? bookkeeping : 0.0) << "}"
+        << ", \"tt_probes\": " << res.tt_probes << ", \"tt_hits\": " << res.tt_hits
+        << ", \"nodes\": " << res.nodes
+        << ", \"peak_rss_kb\": " << peak_rss_kb() << "}";
+}
+
+/// Write the improvements of the incumbent, one row each
+/** Each row holds the instance name, the corridor width, the seed, the
+  wall-clock and cpu time of the improvement, the number of trajectories
+  started so far (states expanded, with the beam engine) and the new value
+  of the incumbent. The rows of a run are sorted by time and time-to-target
+  curves are read directly off them.
+  */
+void write_trace(ostream & out, const brp_options & opt, const brp_result & res)
+{
+    for (unsigned r = 0; r < res.trace.size(); r++)
+        out << setw(12) << res.name << setw(4) << res.delta << setw(12) << opt.seed
+            << fixed << setprecision(4) << setw(12) << res.trace[r].wall << setw(12) << res.trace[r].cpu
+            << defaultfloat << setw(12) << res.trace[r].trajectory << setw(8) << res.trace[r].z << endl;
+}
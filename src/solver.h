@@ -0,0 +1,118 @@
+/*! \file solver.h
+  \brief Solver library: solve a bay given in memory
+
+  A program embedding the solver fills a brp_options (the defaults are
+  those of the command line, see options.cpp) and a brp_instance, and
+  calls brp_solver::solve(), which returns the best solution found as a
+  brp_result:
+  \code
+  brp_options opt;
+  opt.n         = 7;		// max height
+  opt.stop.wall = 5;		// seconds
+  brp_solver solver(opt);
+  brp_instance inst;
+  inst.read("data.tar:data/data5-8-1.dat");	// or fill inst.stacks and inst.nels
+  brp_result res = solver.solve(inst);	// res.z, res.best_time, res.moves
+  \endcode
+  No global state is involved: every call to solve() is an independent
+  run (see cm_run), so several bays can be solved concurrently, by as
+  many threads, with the same solver or with different ones.
+
+  A program solving many bays one after the other (e.g., the service mode,
+  see service.cpp) uses a brp_session instead, which keeps the threads and
+  the work spaces of its run from one bay to the next.
+
+  When the bay changes between two solves (blocks retrieved or stacked,
+  new priorities), the new bay is solved starting from the previous
+  solution, which is repaired into the first incumbent:
+  \code
+  solution_plan(inst.stacks, res.moves, inst.start);	// see instance.h
+  apply_changes(inst.stacks, inst.nels, changes, &inst.start);
+  res = solver.solve(inst);
+  \endcode
+*/
+#ifndef solver_H
+#define solver_H
+#include <ostream>
+#include <string>
+#include <vector>
+#include "bay.h"
+#include "stats.h"
+#include "options.h"
+
+/// Bay to be solved: the blocks of each stack, from bottom to top
+struct brp_instance
+{
+  std::string name;		//!< Instance name (reported in the results)
+  std::vector < std::vector<int> > stacks; //!< Blocks of each stack, bottom to top
+  int nels;			//!< Total number of blocks
+  std::vector < block_move_t > start; //!< Previous solution to start from, by block (optional, see cm_run::warm_start())
+
+  brp_instance(void) : nels(0) {}
+  bool read(const char * filename);
+};
+
+/// Outcome of a run
+struct brp_result
+{
+  std::string name;		//!< Instance name
+  int m;			//!< Number of stacks
+  int nels;			//!< Total number of blocks
+  int delta;			//!< Corridor width used (-1 : whole bay)
+  int z;			//!< Relocations of the best solution found
+  int start_z;			//!< Relocations of the repaired start (-1 : no warm start)
+  int lb;			//!< Lower bound on the number of relocations
+  bool optimal;			//!< The solution matches the lower bound
+  double best_time;		//!< Time to best solution (see cm_run::elapsed_time())
+  double wall;			//!< Wall-clock seconds of the run
+  int stop_reason;		//!< Policy that stopped the run (see stop.h)
+  long trajectories;		//!< Trajectories started
+  long nodes;			//!< Nodes explored (exact engine) or states expanded (beam)
+  long tt_probes;		//!< Transposition table look-ups
+  long tt_hits;			//!< Transposition table hits
+  run_stats stats;		//!< Counters of the run (W_STATS only)
+  std::vector < move_t > moves;	//!< Moves of the best solution
+  std::vector < trace_row > trace; //!< Improvements of the incumbent (brp_options::tracing)
+};
+
+/// Solver of the block relocation problem
+class brp_solver
+{
+public:
+  explicit brp_solver(const brp_options & opt_ = brp_options()) : opt(opt_) {}
+
+  const brp_options & options(void) const { return opt; }
+  brp_result solve(const brp_instance & inst) const;
+
+private:
+  brp_options opt;
+};
+
+class cm_run;
+
+/// Solver keeping its run between solves
+/** The trajectory workers, their work spaces and the transposition table
+  are set up by the first solve and reused by the next ones (see
+  cm_run::prepare()), so that a small bay is solved without creating a
+  thread or allocating a table. The bays are solved one at a time: a
+  session must not be shared by concurrent callers.
+  */
+class brp_session
+{
+public:
+  explicit brp_session(const brp_options & opt = brp_options());
+  ~brp_session();
+
+  brp_result solve(const brp_instance & inst, const brp_options & opt);
+
+private:
+  cm_run * run;
+  brp_session(const brp_session &);
+  brp_session & operator=(const brp_session &);
+};
+
+int run_service(const brp_options & opt, const char * endpoint);
+void write_result(std::ostream & out, const brp_options & opt, const brp_result & res);
+void write_stats(std::ostream & out, const brp_options & opt, const brp_result & res);
+void write_trace(std::ostream & out, const brp_options & opt, const brp_result & res);
+#endif
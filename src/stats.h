@@ -0,0 +1,102 @@
+/*! \file stats.h
+  \brief Performance counters of a run
+
+  The counters tell where the time of a run goes: how many trajectories
+  are started and how many are fathomed, how many neighborhoods and
+  rollouts are evaluated, how wide the corridors actually are once the
+  stacks at the height limit have been dropped, and how the time of the
+  trajectory workers is split between corridor definition, rollouts and
+  everything else (bookkeeping).
+
+  The counters are compiled in only if W_STATS is defined (see the
+  Makefile); otherwise the STATS() statements vanish and the hot loops are
+  exactly as without instrumentation. Each trajectory worker counts in its
+  own work space (see cm_scratch) and its counters are added to the ones
+  of the run when the worker is over, so that no counter is shared among
+  threads.
+*/
+#ifndef stats_H
+#define stats_H
+#include <chrono>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#ifdef W_STATS
+#define STATS(x) x
+#else
+#define STATS(x)
+#endif
+
+/// Counters of a trajectory worker, or of a whole run (see run_stats::add())
+struct run_stats
+{
+  long fathomed;		//!< Trajectories fathomed (z_cum >= best_z)
+  long neighborhoods;		//!< Neighborhoods evaluated
+  long rollouts;		//!< Rollouts played (transposition table hits excluded)
+  long rollout_relocs;		//!< Relocations performed by the rollouts
+  long corridor_sum;		//!< Sum of the corridor sizes
+  int  corridor_min;		//!< Narrowest corridor
+  int  corridor_max;		//!< Widest corridor
+  double t_corridor;		//!< Seconds spent defining the corridors
+  double t_rollout;		//!< Seconds spent evaluating the neighborhoods
+  double t_total;		//!< Seconds spent by the trajectory workers
+
+  run_stats(void) { clear(); }
+  void clear(void)
+  {
+    fathomed = neighborhoods = rollouts = rollout_relocs = corridor_sum = 0;
+    corridor_min = -1;
+    corridor_max = -1;
+    t_corridor = t_rollout = t_total = 0.0;
+  }
+  /// Width of the corridor of a neighborhood
+  void corridor(int width)
+  {
+    neighborhoods++;
+    corridor_sum += width;
+    if (corridor_min == -1 || width < corridor_min)
+      corridor_min = width;
+    if (width > corridor_max)
+      corridor_max = width;
+  }
+  void add(const run_stats & s)
+  {
+    fathomed       += s.fathomed;
+    neighborhoods  += s.neighborhoods;
+    rollouts       += s.rollouts;
+    rollout_relocs += s.rollout_relocs;
+    corridor_sum   += s.corridor_sum;
+    if (s.corridor_min != -1 && (corridor_min == -1 || s.corridor_min < corridor_min))
+      corridor_min = s.corridor_min;
+    if (s.corridor_max > corridor_max)
+      corridor_max = s.corridor_max;
+    t_corridor += s.t_corridor;
+    t_rollout  += s.t_rollout;
+    t_total    += s.t_total;
+  }
+};
+
+/// Improvement of the incumbent (a row of the anytime trace, see write_trace())
+struct trace_row
+{
+  double wall;			//!< Wall-clock seconds since the start of the run
+  double cpu;			//!< Cpu seconds since the start of the run
+  long   trajectory;		//!< Trajectories started (states expanded, beam engine)
+  int    z;			//!< Value of the new incumbent
+};
+
+typedef std::chrono::steady_clock::time_point tick_t;
+
+/// Cheap monotonic clock of the counters (no system call)
+inline tick_t tick(void) { return std::chrono::steady_clock::now(); }
+/// Seconds elapsed from \c a to \c b
+inline double seconds(tick_t a, tick_t b) { return std::chrono::duration<double>(b - a).count(); }
+
+/// Peak resident set size of the process (KB)
+inline long peak_rss_kb(void)
+{
+  struct rusage res;
+  getrusage(RUSAGE_SELF, &res);
+  return res.ru_maxrss;
+}
+#endif
@@ -0,0 +1,70 @@
+/*! \file stop.h
+  \brief Stopping policies of a run
+
+  A run stops as soon as any of the policies below is met (see
+  cm_run::stopping_criterion()):
+  - the incumbent matches the lower bound of the instance (it is optimal);
+  - the incumbent reaches a target value;
+  - a wall-clock deadline is reached;
+  - a cpu budget is spent;
+  - a number of trajectories have been started, or started since the
+    last improvement of the incumbent (corridor method only).
+
+  The stopping test is polled very often (once per retrieved block along
+  a trajectory), so the clocks are not read at every poll: a countdown
+  (see clock_countdown) lets the clocks be read about once per
+  millisecond, whatever the time between two polls.
+*/
+#ifndef stop_H
+#define stop_H
+#include "stats.h"
+
+/// Reason why a run stopped (STOP_NONE : still running, or search over)
+enum { STOP_NONE, STOP_LB, STOP_TARGET, STOP_WALL, STOP_CPU, STOP_TRAJECTORIES, STOP_STALL };
+
+/// Stopping policies of a run (0, or -1 for the target, : policy not used)
+struct stop_policy
+{
+  double wall;			//!< Wall-clock deadline (seconds from the start of the run)
+  double cpu;			//!< Cpu budget (seconds, see cm_run::cpu_time())
+  long   trajectories;		//!< Max trajectories started
+  long   stall;			//!< Max trajectories started without improvement
+  int    target;		//!< Stop once the incumbent is not above this value
+  bool   at_lb;			//!< Stop once the incumbent matches the lower bound
+
+  stop_policy(void) : wall(0), cpu(0), trajectories(0), stall(0), target(-1), at_lb(true) {}
+};
+
+/// Amortized countdown to the next clock reading
+/** due() is true once every \c period calls; each time, the period is
+  scaled so that the clock is read about every \c interval seconds
+  (between 1 and \c max_period calls). A thread polling a stopping test
+  keeps its own countdown.
+  */
+class clock_countdown
+{
+public:
+  clock_countdown(void) : count(0), period(1), last(tick()) {}
+
+  bool due(void)
+  {
+    if (--count > 0)
+      return false;
+    tick_t now = tick();
+    double dt  = seconds(last, now);
+    last = now;
+    double p = (dt > 0.0) ? period*interval/dt : 2.0*period;
+    if (p > 2.0*period)
+      p = 2.0*period;		// grow slowly, shrink at once
+    period = (p < 1.0) ? 1 : (p > max_period) ? max_period : (int)p;
+    count  = period;
+    return true;
+  }
+private:
+  static constexpr double interval = 1.0E-3;
+  static const int max_period = 4096;
+  int count;
+  int period;
+  tick_t last;
+};
+#endif
@@ -15,6 +15,12 @@ timer::timer(void) {
   
   gettimeofday( &tp, 0 );
   real_time =    (double) tp.tv_sec + (double) tp.tv_usec * 1.0E-6;
+
+  getrusage( RUSAGE_THREAD, &res );
+  thread_time = (double) res.ru_utime.tv_sec +
+    (double) res.ru_stime.tv_sec +
+    (double) res.ru_utime.tv_usec * 1.0E-6 +
+    (double) res.ru_stime.tv_usec * 1.0E-6;
 }
 
 void
@@ -27,24 +33,35 @@ timer::resetTime() {
   
   gettimeofday( &tp, 0 );
   real_time =    (double) tp.tv_sec + (double) tp.tv_usec * 1.0E-6;
+
+  getrusage( RUSAGE_THREAD, &res );
+  thread_time = (double) res.ru_utime.tv_sec +
+    (double) res.ru_stime.tv_sec +
+    (double) res.ru_utime.tv_usec * 1.0E-6 +
+    (double) res.ru_stime.tv_usec * 1.0E-6;
 }
 
 /*
  *  Stop the stopwatch and return the time used in seconds (either
- *  REAL or VIRTUAL time, depending on ``type'').
+ *  REAL, VIRTUAL or THREAD time, depending on ``type''). The clock is read
+ *  into local structures, so that several threads can query the same timer.
+ *  THREAD time is the cpu time of the calling thread only, and is meaningful
+ *  only if the timer was reset by that same thread.
  */
 double timer::elapsedTime(const TYPE& type) {
   if (type == REAL) {
-    gettimeofday( &tp, 0 );
-    return( (double) tp.tv_sec + (double) tp.tv_usec * 1.0E-6 - real_time );
+    struct timeval now;
+    gettimeofday( &now, 0 );
+    return( (double) now.tv_sec + (double) now.tv_usec * 1.0E-6 - real_time );
   }
   else {
-    getrusage( RUSAGE_SELF, &res );
-    return( (double) res.ru_utime.tv_sec +
-	    (double) res.ru_stime.tv_sec +
-	    (double) res.ru_utime.tv_usec * 1.0E-6 +
-	    (double) res.ru_stime.tv_usec * 1.0E-6
-	    - virtual_time );
+    struct rusage now;
+    getrusage( (type == THREAD) ? RUSAGE_THREAD : RUSAGE_SELF, &now );
+    return( (double) now.ru_utime.tv_sec +
+	    (double) now.ru_stime.tv_sec +
+	    (double) now.ru_utime.tv_usec * 1.0E-6 +
+	    (double) now.ru_stime.tv_usec * 1.0E-6
+	    - ((type == THREAD) ? thread_time : virtual_time) );
   }
 }
 
@@ -7,10 +7,10 @@ class timer {
 private:
   struct rusage res;
   struct timeval tp;
-  double virtual_time, real_time;
+  double virtual_time, real_time, thread_time;
 
 public:
-  enum TYPE {REAL, VIRTUAL};
+  enum TYPE {REAL, VIRTUAL, THREAD};
   timer(void);
   void resetTime();
   double elapsedTime(const TYPE& type);
@@ -0,0 +1,95 @@
+/*! \file ttable.h
+  \brief Transposition table of the look-ahead values
+
+  Different trajectories (and different corridors along a trajectory)
+  keep reaching the same intermediate bays. The look-ahead value of a bay
+  (see block_heuristic()) only depends on the configuration and on the
+  next block to be retrieved, so it is stored in a table indexed by the
+  Zobrist hash of the bay (see bay_t::hash) and looked up before running
+  the rollout again.
+
+  The table has a fixed number of entries (a power of 2) and a new value
+  always replaces the one in its entry. It is shared by all the threads of
+  a run without any lock: each entry is made up by two words, the value
+  and the key xor-ed with the value, written and read independently, so
+  that an entry torn by a concurrent write is seen as a miss (R. Hyatt and
+  T. Mann, "A lockless transposition table implementation for parallel
+  search", ICGA Journal, 25(1), 2002).
+
+  When a run is solved again (see brp_session), the table is not cleared:
+  the keys are salted with a value drawn anew for every run, so that the
+  entries of the previous runs are seen as misses.
+*/
+#ifndef ttable_H
+#define ttable_H
+#include <atomic>
+#include <stdint.h>
+#include "bay.h"
+#include "rng.h"
+
+class ttable {
+public:
+  ttable(void) : entries(0), mask(0), salt(0), seq(0) {}
+  ~ttable(void) { delete [] entries; }
+
+  /// Allocate (and clear) a table of 2^\c bits entries (0 : no table)
+  /** A table of the same size is kept, and only its salt is renewed. */
+  void init(int bits)
+  {
+    salt = splitmix64(seq);
+    if (bits > 0 && entries != 0 && mask == ((uint64_t)1 << bits) - 1)
+      return;
+    delete [] entries;
+    entries = 0;
+    mask    = 0;
+    if (bits <= 0)
+      return;
+    mask    = ((uint64_t)1 << bits) - 1;
+    entries = new entry[mask + 1];
+    for (uint64_t e = 0; e <= mask; e++)
+    {
+      entries[e].check.store(0, std::memory_order_relaxed);
+      entries[e].data.store(0, std::memory_order_relaxed);
+    }
+  }
+  bool enabled(void) const { return entries != 0; }
+
+  /// Key of \c bay when block \c l is the next block to be retrieved
+  static uint64_t key(const bay_t & bay, int l)
+  {
+    return bay.hash ^ zobrist(bay.m*bay.cap, l);
+  }
+  /// Look up the value stored for \c key
+  bool probe(uint64_t key, int & value) const
+  {
+    key ^= salt;
+    const entry & e = entries[key & mask];
+    uint64_t data   = e.data.load(std::memory_order_relaxed);
+    if (data == 0 || (e.check.load(std::memory_order_relaxed) ^ data) != key)
+      return false;
+    value = (int)(data - 1);
+    return true;
+  }
+  /// Store \c value for \c key (a complete rollout value only)
+  void store(uint64_t key, int value)
+  {
+    key ^= salt;
+    entry & e     = entries[key & mask];
+    uint64_t data = (uint64_t)value + 1;	// 0 : empty entry
+    e.check.store(key ^ data, std::memory_order_relaxed);
+    e.data.store(data, std::memory_order_relaxed);
+  }
+
+private:
+  struct entry {
+    std::atomic<uint64_t> check; //!< key ^ data
+    std::atomic<uint64_t> data;  //!< value + 1
+  };
+  entry * entries;
+  uint64_t mask;
+  uint64_t salt;		//!< Salt of the keys of the current run
+  uint64_t seq;			//!< State of the salt generator (see splitmix64())
+  ttable(const ttable &);
+  ttable & operator=(const ttable &);
+};
+#endif